@@ -0,0 +1,65 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+arena::arena(size_t block_size) : m_block_size(block_size), m_offset(0), m_used(0), m_reserved(0)
+{}
+
+arena::~arena()
+{
+    for (auto it = m_finalizers.rbegin(); it != m_finalizers.rend(); ++it)
+    {
+        it->destroy(it->first, it->count);
+    }
+}
+
+void *arena::allocate(size_t bytes, size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_blocks.empty())
+    {
+        auto &current = m_blocks.back();
+        auto base = reinterpret_cast<uintptr_t>(current.memory.get());
+        auto aligned = (base + m_offset + alignment - 1) / alignment * alignment - base;
+
+        if (aligned + bytes <= current.size)
+        {
+            m_offset = aligned + bytes;
+            m_used += bytes;
+            return current.memory.get() + aligned;
+        }
+    }
+
+    if (bytes + alignment > m_block_size / 4 && !m_blocks.empty())
+    {
+        // Large requests get a block of their own, kept behind the current one.
+        auto size = bytes + alignment;
+        m_blocks.insert(m_blocks.end() - 1, block{std::unique_ptr<char[]>(new char[size]), size});
+        m_reserved += size;
+        m_used += bytes;
+
+        auto memory = (m_blocks.end() - 2)->memory.get();
+        auto base = reinterpret_cast<uintptr_t>(memory);
+
+        return memory + ((base + alignment - 1) / alignment * alignment - base);
+    }
+
+    auto size = std::max(m_block_size, bytes + alignment);
+    m_blocks.push_back(block{std::unique_ptr<char[]>(new char[size]), size});
+    m_reserved += size;
+
+    auto base = reinterpret_cast<uintptr_t>(m_blocks.back().memory.get());
+    auto aligned = (base + alignment - 1) / alignment * alignment - base;
+
+    m_offset = aligned + bytes;
+    m_used += bytes;
+
+    return m_blocks.back().memory.get() + aligned;
+}
+
+void arena::on_release(void *first, size_t count, void (*destroy)(void *, size_t))
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finalizers.push_back(finalizer{destroy, first, count});
+}
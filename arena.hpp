@@ -0,0 +1,257 @@
+#ifndef EXPLORER_ARENA_HPP
+#define EXPLORER_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Bump-pointer allocator whose memory is released all at once when it is
+ * destroyed.
+ *
+ * Allocation is thread-safe, so objects decoded in parallel can share one
+ * arena. Nothing is freed individually. Objects constructed with make() or
+ * arena_array have their destructors run, in reverse order, when the arena
+ * goes away.
+ */
+class arena
+{
+public:
+    explicit arena(size_t block_size = 1 << 20);
+
+    arena(const arena &) = delete;
+
+    arena &operator=(const arena &) = delete;
+
+    ~arena();
+
+    void *allocate(size_t bytes, size_t alignment);
+
+    /**
+     * Constructs count default-initialized Ts in one contiguous run.
+     */
+    template<typename T>
+    T *make(size_t count = 1)
+    {
+        auto items = static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+
+        for (size_t i = 0; i < count; i++)
+        {
+            new(items + i) T();
+        }
+
+        if (!std::is_trivially_destructible<T>::value && count > 0)
+        {
+            on_release(items, count, [](void *first, size_t n)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    static_cast<T *>(first)[i].~T();
+                }
+            });
+        }
+
+        return items;
+    }
+
+    /**
+     * @return bytes handed out so far
+     */
+    size_t used() const
+    {
+        return m_used;
+    }
+
+    /**
+     * @return bytes reserved from the heap, including unused block tails
+     */
+    size_t reserved() const
+    {
+        return m_reserved;
+    }
+
+private:
+    struct block
+    {
+        std::unique_ptr<char[]> memory;
+        size_t size;
+    };
+
+    struct finalizer
+    {
+        void (*destroy)(void *first, size_t count);
+        void *first;
+        size_t count;
+    };
+
+    size_t m_block_size;
+    std::vector<block> m_blocks;
+    std::vector<finalizer> m_finalizers;
+    size_t m_offset; // into m_blocks.back()
+    size_t m_used;
+    size_t m_reserved;
+    std::mutex m_mutex;
+
+    void on_release(void *first, size_t count, void (*destroy)(void *, size_t));
+};
+
+/**
+ * Allocator for standard containers that draws from an arena. Without an
+ * arena it falls back to the heap, so one container type serves both cases.
+ */
+template<typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    arena_allocator(::arena *arena = nullptr) noexcept : m_arena(arena)
+    {}
+
+    template<typename U>
+    arena_allocator(const arena_allocator<U> &other) noexcept : m_arena(other.get_arena())
+    {}
+
+    T *allocate(size_t count)
+    {
+        if (m_arena != nullptr)
+        {
+            return static_cast<T *>(m_arena->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        return static_cast<T *>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T *pointer, size_t)
+    {
+        if (m_arena == nullptr)
+        {
+            ::operator delete(pointer);
+        }
+    }
+
+    ::arena *get_arena() const noexcept
+    {
+        return m_arena;
+    }
+
+    template<typename U>
+    bool operator==(const arena_allocator<U> &other) const noexcept
+    {
+        return m_arena == other.get_arena();
+    }
+
+    template<typename U>
+    bool operator!=(const arena_allocator<U> &other) const noexcept
+    {
+        return m_arena != other.get_arena();
+    }
+
+private:
+    ::arena *m_arena;
+};
+
+/**
+ * Contiguous run of records in an arena. A non-owning view: the arena
+ * constructs and destroys the elements. Appending past the capacity moves
+ * the run to a larger one.
+ */
+template<typename T>
+class arena_array
+{
+public:
+    arena_array() : m_arena(nullptr), m_data(nullptr), m_size(0), m_capacity(0)
+    {}
+
+    arena_array(::arena &arena, size_t capacity) : m_arena(&arena), m_data(nullptr), m_size(0), m_capacity(0)
+    {
+        reserve(capacity);
+    }
+
+    T &emplace_back()
+    {
+        if (m_size == m_capacity)
+        {
+            reserve(m_capacity == 0 ? 4 : m_capacity * 2);
+        }
+
+        return m_data[m_size++];
+    }
+
+    void reserve(size_t capacity)
+    {
+        if (capacity <= m_capacity)
+        {
+            return;
+        }
+
+        if (m_arena == nullptr)
+        {
+            throw std::logic_error("arena_array has no arena");
+        }
+
+        auto data = m_arena->make<T>(capacity);
+
+        for (size_t i = 0; i < m_size; i++)
+        {
+            data[i] = std::move(m_data[i]);
+        }
+
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    T &operator[](size_t index)
+    {
+        return m_data[index];
+    }
+
+    const T &operator[](size_t index) const
+    {
+        return m_data[index];
+    }
+
+    T *begin()
+    {
+        return m_data;
+    }
+
+    T *end()
+    {
+        return m_data + m_size;
+    }
+
+    const T *begin() const
+    {
+        return m_data;
+    }
+
+    const T *end() const
+    {
+        return m_data + m_size;
+    }
+
+private:
+    ::arena *m_arena;
+    T *m_data;
+    size_t m_size;
+    size_t m_capacity;
+};
+
+
+#endif //EXPLORER_ARENA_HPP
@@ -0,0 +1,504 @@
+#include "baked_bundle.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sys/stat.h>
+#include <boost/filesystem.hpp>
+#include "solid_list_stream.hpp"
+#include "texture_pack_stream.hpp"
+
+const unsigned int kBakedMagic = 0x314b4258; // "XBK1"
+const unsigned long long kNoFaces = ~0ull;      // baked_object::faces of a mesh without an index buffer
+
+static_assert(sizeof(baked_header) == 8 + 16 + 9 * 16, "baked_header has no padding");
+static_assert(sizeof(baked_object) % 8 == 0 && sizeof(baked_vertex_buffer) % 8 == 0, "baked records stay aligned");
+static_assert(sizeof(solid_mesh_face) == 8, "faces are stored as-is");
+
+/**
+ * Size and modification time of the bundle a bake belongs to. The time is in
+ * nanoseconds, so a same-size rewrite within the second of a bake still
+ * makes the bake stale.
+ */
+static void bundle_stamp(const std::string &bundle_path, unsigned long long &size, long long &time)
+{
+    struct stat st{};
+
+    if (stat(bundle_path.c_str(), &st) != 0)
+    {
+        throw std::runtime_error(string_format("Can't stat %s: %s", bundle_path.c_str(), strerror(errno)));
+    }
+
+    size = (unsigned long long) st.st_size;
+    time = (long long) st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+}
+
+/**
+ * Collects the tables of a bake before they are laid out.
+ */
+struct bake_writer
+{
+    std::vector<baked_resource> resources;
+    std::vector<baked_texture_pack> texture_packs;
+    std::vector<baked_texture> textures;
+    std::vector<baked_solid_list> solid_lists;
+    std::vector<baked_object> objects;
+    std::vector<baked_material> materials;
+    std::vector<baked_vertex_buffer> vertex_buffers;
+    std::string strings;
+    std::vector<unsigned char> data;
+
+    baked_string add_string(const std::string &text)
+    {
+        baked_string result{(unsigned int) strings.size(), (unsigned int) text.size()};
+        strings += text;
+
+        return result;
+    }
+
+    unsigned long long add_data(const void *bytes, size_t size)
+    {
+        auto offset = data.size();
+        data.resize((offset + size + 7) & ~size_t(7));
+        memcpy(data.data() + offset, bytes, size);
+
+        return offset;
+    }
+
+    void add(const texture_pack &pack)
+    {
+        resources.push_back(baked_resource{0, (unsigned int) texture_packs.size()});
+        texture_packs.push_back(baked_texture_pack{
+                add_string(pack.name), add_string(pack.pipeline_path), pack.hash, (unsigned int) textures.size(),
+                (unsigned int) pack.textures.size()
+        });
+
+        for (auto &texture : pack.textures)
+        {
+            textures.push_back(baked_texture{
+                    add_string(texture->name), texture->width, texture->height, texture->mipmaps, texture->dds_type,
+                    texture->texture_hash, texture->type_hash, texture->data_offset, texture->data_size,
+                    texture->source_offset
+            });
+        }
+    }
+
+    void add(const solid_list &list)
+    {
+        resources.push_back(baked_resource{1, (unsigned int) solid_lists.size()});
+        solid_lists.push_back(baked_solid_list{
+                add_string(list.pipeline_path), add_string(list.class_type), (unsigned int) objects.size(),
+                (unsigned int) list.solid_objects.size()
+        });
+
+        for (auto &object : list.solid_objects)
+        {
+            baked_object baked{};
+
+            baked.name = add_string(object.name);
+            baked.hash = object.hash;
+            baked.position[0] = object.posX;
+            baked.position[1] = object.posY;
+            baked.position[2] = object.posZ;
+            memcpy(baked.transform, object.transform.m, sizeof(baked.transform));
+            memcpy(baked.min_point, &object.min_point, sizeof(baked.min_point));
+            memcpy(baked.max_point, &object.max_point, sizeof(baked.max_point));
+            baked.source_offset = object.source_offset;
+            baked.source_length = object.source_length;
+            baked.texture_hash_count = (unsigned int) object.texture_hashes.size();
+            baked.texture_hashes = add_data(object.texture_hashes.begin(),
+                                            object.texture_hashes.size() * sizeof(unsigned int));
+
+            if (auto mesh = object.mesh)
+            {
+                baked.has_mesh = 1;
+                baked.flags = mesh->flags;
+                baked.num_materials = mesh->num_materials;
+                baked.num_vertex_buffers = mesh->num_vertex_buffers;
+                baked.num_vertices = mesh->num_vertices;
+                baked.num_tris = mesh->num_tris;
+                baked.faces_offset = mesh->faces_offset;
+                baked.first_material = (unsigned int) materials.size();
+                baked.material_count = (unsigned int) mesh->materials.size();
+                baked.first_vertex_buffer = (unsigned int) vertex_buffers.size();
+                baked.vertex_buffer_count = (unsigned int) mesh->vertex_buffers.size();
+
+                for (auto &material : mesh->materials)
+                {
+                    baked_material record{};
+                    record.name = add_string(material.name);
+                    record.num_vertices = material.num_vertices;
+                    record.num_tris = material.num_tris;
+                    record.num_indices = material.num_indices;
+                    record.hash = material.hash;
+                    record.texture_hash = material.texture_hash;
+                    record.vertex_stream_index = material.vertex_stream_index;
+                    record.index_shift = material.index_shift;
+                    memcpy(record.min_point, &material.min_point, sizeof(record.min_point));
+                    memcpy(record.max_point, &material.max_point, sizeof(record.max_point));
+                    materials.push_back(record);
+                }
+
+                for (auto &vb : mesh->vertex_buffers)
+                {
+                    auto payload = vb.data.get();
+
+                    vertex_buffers.push_back(baked_vertex_buffer{
+                            vb.position, vb.length, vb.num_verts, vb.stride, vb.source_offset,
+                            (unsigned int) payload->size(), add_data(payload->data(), payload->size() * sizeof(float))
+                    });
+                }
+
+                baked.faces = kNoFaces;
+
+                if (mesh->faces)
+                {
+                    auto faces = mesh->faces.get();
+                    baked.face_count = faces->size();
+                    baked.faces = add_data(faces->data(), faces->size() * sizeof(solid_mesh_face));
+                }
+            }
+
+            objects.push_back(baked);
+        }
+    }
+};
+
+template<typename T>
+static baked_table write_table(std::ostream &stream, unsigned long long &offset, const T *items, size_t count)
+{
+    static const char zeros[8] = {};
+    auto bytes = count * sizeof(T);
+    baked_table table{offset, count};
+
+    stream.write((const char *) items, bytes);
+    stream.write(zeros, (8 - bytes % 8) % 8);
+    offset += (bytes + 7) & ~size_t(7);
+
+    return table;
+}
+
+void baked_bundle::write(const std::string &path, const std::string &bundle_path,
+                         const std::vector<std::shared_ptr<base_data_resource>> &resources)
+{
+    bake_writer writer;
+
+    for (auto &resource : resources)
+    {
+        if (auto tp = std::dynamic_pointer_cast<texture_pack>(resource))
+        {
+            writer.add(*tp);
+        } else if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+        {
+            writer.add(*slp);
+        }
+    }
+
+    baked_header header{};
+    header.magic = kBakedMagic;
+    header.version = kBakedVersion;
+    bundle_stamp(bundle_path, header.bundle_size, header.bundle_time);
+
+    auto temp_path = path + ".tmp";
+
+    {
+        std::ofstream stream(temp_path, std::ios::trunc | std::ios::binary);
+        unsigned long long offset = sizeof(header);
+
+        // The header is rewritten once the table offsets are known.
+        stream.write((const char *) &header, sizeof(header));
+
+        header.resources = write_table(stream, offset, writer.resources.data(), writer.resources.size());
+        header.texture_packs = write_table(stream, offset, writer.texture_packs.data(), writer.texture_packs.size());
+        header.textures = write_table(stream, offset, writer.textures.data(), writer.textures.size());
+        header.solid_lists = write_table(stream, offset, writer.solid_lists.data(), writer.solid_lists.size());
+        header.objects = write_table(stream, offset, writer.objects.data(), writer.objects.size());
+        header.materials = write_table(stream, offset, writer.materials.data(), writer.materials.size());
+        header.vertex_buffers = write_table(stream, offset, writer.vertex_buffers.data(),
+                                            writer.vertex_buffers.size());
+        header.strings = write_table(stream, offset, writer.strings.data(), writer.strings.size());
+        header.data = write_table(stream, offset, writer.data.data(), writer.data.size());
+
+        stream.seekp(0);
+        stream.write((const char *) &header, sizeof(header));
+
+        if (!stream)
+        {
+            throw std::runtime_error(string_format("Cannot write %s", temp_path.c_str()));
+        }
+    }
+
+    boost::filesystem::rename(temp_path, path);
+}
+
+std::unique_ptr<baked_bundle> baked_bundle::open(const std::string &path, const std::string &bundle_path)
+{
+    if (!boost::filesystem::is_regular_file(path) || !boost::filesystem::is_regular_file(bundle_path))
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<baked_bundle> bundle(new baked_bundle);
+    bundle->m_source = byte_source::open(path);
+    bundle->m_base = bundle->m_source->data();
+
+    if (bundle->m_source->size() < sizeof(baked_header))
+    {
+        return nullptr;
+    }
+
+    if (bundle->m_base == nullptr)
+    {
+        bundle->m_copy.resize(bundle->m_source->size());
+        bundle->m_source->read_at(bundle->m_copy.data(), bundle->m_copy.size(), 0);
+        bundle->m_base = bundle->m_copy.data();
+    }
+
+    auto &header = bundle->header();
+    unsigned long long bundle_size;
+    long long bundle_time;
+    bundle_stamp(bundle_path, bundle_size, bundle_time);
+
+    if (header.magic != kBakedMagic
+        || header.version != kBakedVersion
+        || header.bundle_size != bundle_size
+        || header.bundle_time != bundle_time
+        || !bundle->valid())
+    {
+        return nullptr;
+    }
+
+    return bundle;
+}
+
+bool baked_bundle::valid() const
+{
+    auto &h = header();
+    auto size = m_source->size();
+
+    auto fits = [size](const baked_table &table, size_t record_size)
+    {
+        return table.offset % 8 == 0 && table.offset <= size && table.count <= (size - table.offset) / record_size;
+    };
+
+    return fits(h.resources, sizeof(baked_resource))
+           && fits(h.texture_packs, sizeof(baked_texture_pack))
+           && fits(h.textures, sizeof(baked_texture))
+           && fits(h.solid_lists, sizeof(baked_solid_list))
+           && fits(h.objects, sizeof(baked_object))
+           && fits(h.materials, sizeof(baked_material))
+           && fits(h.vertex_buffers, sizeof(baked_vertex_buffer))
+           && fits(h.strings, 1)
+           && fits(h.data, 1);
+}
+
+std::string baked_bundle::string(const baked_string &string) const
+{
+    if ((unsigned long long) string.offset + string.length > header().strings.count)
+    {
+        throw std::runtime_error(string_format("Corrupt string in %s", m_source->path().c_str()));
+    }
+
+    return std::string((const char *) m_base + header().strings.offset + string.offset, string.length);
+}
+
+/**
+ * @throws std::runtime_error unless [first, first + count) lies inside a table of size items
+ */
+static void check_range(const std::string &path, unsigned long long first, unsigned long long count,
+                        unsigned long long size)
+{
+    if (first > size || count > size - first)
+    {
+        throw std::runtime_error(string_format("Corrupt bake %s", path.c_str()));
+    }
+}
+
+std::vector<std::shared_ptr<base_data_resource>>
+baked_bundle::resources(std::shared_ptr<const byte_source> bundle, std::shared_ptr<resource_cache> cache) const
+{
+    TRACE_SCOPE("baked_bundle::resources");
+
+    auto &h = header();
+    auto &path = m_source->path();
+    auto source = m_source;
+    auto data_base = h.data.offset;
+    std::vector<std::shared_ptr<base_data_resource>> result;
+
+    auto data_range = [&](unsigned long long offset, unsigned long long bytes)
+    {
+        check_range(path, offset, bytes, h.data.count);
+        return data_base + offset;
+    };
+
+    for (auto r = 0ull; r < h.resources.count; r++)
+    {
+        auto &resource = table<baked_resource>(h.resources)[r];
+
+        if (resource.kind == 0)
+        {
+            check_range(path, resource.index, 1, h.texture_packs.count);
+
+            auto &baked = table<baked_texture_pack>(h.texture_packs)[resource.index];
+            auto pack = std::make_shared<texture_pack>();
+
+            pack->name = string(baked.name);
+            pack->pipeline_path = string(baked.pipeline_path);
+            pack->hash = baked.hash;
+
+            check_range(path, baked.first_texture, baked.texture_count, h.textures.count);
+
+            for (auto i = 0u; i < baked.texture_count; i++)
+            {
+                auto &record = table<baked_texture>(h.textures)[baked.first_texture + i];
+                auto texture = std::make_shared<::texture>();
+
+                texture->name = string(record.name);
+                texture->width = record.width;
+                texture->height = record.height;
+                texture->mipmaps = record.mipmaps;
+                texture->dds_type = record.dds_type;
+                texture->texture_hash = record.texture_hash;
+                texture->type_hash = record.type_hash;
+                texture->data_offset = record.data_offset;
+                texture->data_size = record.data_size;
+                texture->source_offset = record.source_offset;
+
+                auto source_offset = record.source_offset;
+                auto data_size = record.data_size;
+
+                texture->data = cached<std::vector<unsigned char>>(
+                        cache, cache_key{bundle->id(), 0x33320002, source_offset}, nullptr,
+                        [bundle, source_offset, data_size]()
+                        {
+                            return bundle->read_vector_at<unsigned char>(source_offset, data_size);
+                        });
+
+                pack->textures.push_back(texture);
+            }
+
+            result.push_back(pack);
+        } else if (resource.kind == 1)
+        {
+            check_range(path, resource.index, 1, h.solid_lists.count);
+
+            auto &baked = table<baked_solid_list>(h.solid_lists)[resource.index];
+            auto list = std::make_shared<solid_list>();
+            auto &storage = *list->storage;
+
+            list->pipeline_path = string(baked.pipeline_path);
+            list->class_type = string(baked.class_type);
+
+            check_range(path, baked.first_object, baked.object_count, h.objects.count);
+            list->solid_objects = arena_array<solid_object>(storage, baked.object_count);
+
+            for (auto i = 0u; i < baked.object_count; i++)
+            {
+                auto &record = table<baked_object>(h.objects)[baked.first_object + i];
+                auto &object = list->solid_objects.emplace_back();
+
+                object.name = string(record.name);
+                object.hash = record.hash;
+                object.posX = record.position[0];
+                object.posY = record.position[1];
+                object.posZ = record.position[2];
+                memcpy(object.transform.m, record.transform, sizeof(record.transform));
+                memcpy(&object.min_point, record.min_point, sizeof(record.min_point));
+                memcpy(&object.max_point, record.max_point, sizeof(record.max_point));
+                object.source_offset = record.source_offset;
+                object.source_length = record.source_length;
+
+                auto hashes = data_range(record.texture_hashes, record.texture_hash_count * 4ull);
+                object.texture_hashes = arena_array<unsigned int>(storage, record.texture_hash_count);
+
+                for (auto t = 0u; t < record.texture_hash_count; t++)
+                {
+                    object.texture_hashes.emplace_back() = reinterpret_cast<const unsigned int *>(m_base + hashes)[t];
+                }
+
+                if (!record.has_mesh)
+                {
+                    continue;
+                }
+
+                auto mesh = storage.make<solid_mesh>();
+                mesh->flags = record.flags;
+                mesh->num_materials = record.num_materials;
+                mesh->num_vertex_buffers = record.num_vertex_buffers;
+                mesh->num_vertices = record.num_vertices;
+                mesh->num_tris = record.num_tris;
+                mesh->faces_offset = record.faces_offset;
+
+                check_range(path, record.first_material, record.material_count, h.materials.count);
+                mesh->materials = arena_array<solid_mesh_material>(storage, record.material_count);
+
+                for (auto m = 0u; m < record.material_count; m++)
+                {
+                    auto &baked_material = table<::baked_material>(h.materials)[record.first_material + m];
+                    auto &material = mesh->materials.emplace_back();
+
+                    material.name = string(baked_material.name);
+                    material.num_vertices = baked_material.num_vertices;
+                    material.num_tris = baked_material.num_tris;
+                    material.num_indices = baked_material.num_indices;
+                    material.hash = baked_material.hash;
+                    material.texture_hash = baked_material.texture_hash;
+                    material.vertex_stream_index = baked_material.vertex_stream_index;
+                    material.index_shift = baked_material.index_shift;
+                    memcpy(&material.min_point, baked_material.min_point, sizeof(baked_material.min_point));
+                    memcpy(&material.max_point, baked_material.max_point, sizeof(baked_material.max_point));
+                }
+
+                check_range(path, record.first_vertex_buffer, record.vertex_buffer_count, h.vertex_buffers.count);
+                mesh->vertex_buffers = arena_array<vertex_buffer>(storage, record.vertex_buffer_count);
+
+                for (auto v = 0u; v < record.vertex_buffer_count; v++)
+                {
+                    auto &baked_vb = table<baked_vertex_buffer>(h.vertex_buffers)[record.first_vertex_buffer + v];
+                    auto &vb = mesh->vertex_buffers.emplace_back();
+
+                    vb.position = baked_vb.position;
+                    vb.length = baked_vb.length;
+                    vb.num_verts = baked_vb.num_verts;
+                    vb.stride = baked_vb.stride;
+                    vb.source_offset = baked_vb.source_offset;
+
+                    auto offset = data_range(baked_vb.data, baked_vb.float_count * 4ull);
+                    auto count = baked_vb.float_count;
+
+                    vb.data = cached<float_buffer>(
+                            cache, cache_key{source->id(), 0x134b01, offset}, nullptr,
+                            [source, offset, count]()
+                            {
+                                auto data = std::make_shared<float_buffer>(count);
+                                source->read_at(data->data(), count * sizeof(float), offset);
+
+                                return data;
+                            });
+                }
+
+                object.mesh = mesh;
+
+                if (record.faces == kNoFaces)
+                {
+                    continue;
+                }
+
+                auto faces_offset = data_range(record.faces, record.face_count * sizeof(solid_mesh_face));
+                auto face_count = record.face_count;
+
+                mesh->faces = cached<face_buffer>(
+                        cache, cache_key{source->id(), 0x134b03, faces_offset}, nullptr,
+                        [source, faces_offset, face_count]()
+                        {
+                            auto faces = std::make_shared<face_buffer>(face_count);
+                            source->read_at(faces->data(), face_count * sizeof(solid_mesh_face), faces_offset);
+
+                            return faces;
+                        });
+            }
+
+            result.push_back(list);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,163 @@
+#ifndef EXPLORER_BAKED_BUNDLE_HPP
+#define EXPLORER_BAKED_BUNDLE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "byte_source.hpp"
+#include "chunk_stream.hpp"
+
+/**
+ * Bump whenever the layout below or the decoding that produces it changes.
+ */
+const unsigned int kBakedVersion = 2;
+
+struct baked_table
+{
+    unsigned long long offset; // from the start of the file
+    unsigned long long count;
+};
+
+struct baked_string
+{
+    unsigned int offset; // into the string table
+    unsigned int length;
+};
+
+struct baked_header
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long bundle_size;
+    long long bundle_time; // modification time in nanoseconds
+    baked_table resources;      // baked_resource, in bundle order
+    baked_table texture_packs;  // baked_texture_pack
+    baked_table textures;       // baked_texture
+    baked_table solid_lists;    // baked_solid_list
+    baked_table objects;        // baked_object
+    baked_table materials;      // baked_material
+    baked_table vertex_buffers; // baked_vertex_buffer
+    baked_table strings;        // bytes
+    baked_table data;           // bytes: texture hashes, vertex floats, faces; 8-byte aligned runs
+};
+
+struct baked_resource
+{
+    unsigned int kind; // 0: texture pack, 1: solid list
+    unsigned int index;
+};
+
+struct baked_texture_pack
+{
+    baked_string name, pipeline_path;
+    unsigned int hash;
+    unsigned int first_texture, texture_count;
+};
+
+struct baked_texture
+{
+    baked_string name;
+    unsigned int width, height, mipmaps;
+    unsigned int dds_type, texture_hash, type_hash;
+    unsigned int data_offset, data_size, source_offset; // payload stays in the bundle
+};
+
+struct baked_solid_list
+{
+    baked_string pipeline_path, class_type;
+    unsigned int first_object, object_count;
+};
+
+struct baked_object
+{
+    baked_string name;
+    unsigned int hash;
+    float position[3];
+    float transform[16];
+    float min_point[3], max_point[3];
+    unsigned int source_offset, source_length;
+    unsigned int texture_hash_count;
+    unsigned int has_mesh;
+    unsigned long long texture_hashes; // data offset
+    unsigned int flags, num_materials, num_vertex_buffers, num_vertices, num_tris, faces_offset;
+    unsigned int first_material, material_count;
+    unsigned int first_vertex_buffer, vertex_buffer_count;
+    unsigned long long faces; // data offset of rebased solid_mesh_faces, or ~0 if the mesh has none
+    unsigned long long face_count;
+};
+
+struct baked_material
+{
+    baked_string name;
+    unsigned int num_vertices, num_tris, num_indices;
+    unsigned int hash, texture_hash, vertex_stream_index, index_shift;
+    float min_point[3], max_point[3];
+};
+
+struct baked_vertex_buffer
+{
+    unsigned int position, length, num_verts, stride, source_offset;
+    unsigned int float_count;
+    unsigned long long data; // data offset
+};
+
+/**
+ * Decoded texture packs and solid lists of one bundle, saved next to it so
+ * that later runs skip parsing.
+ *
+ * The file is mapped and read in place: every table is a fixed-size record
+ * array and every reference is an offset. Texture payloads are not copied;
+ * they are read from the bundle. Vertex and face payloads are copied out of
+ * the mapping when first used. A bake is only used while the bundle's size
+ * and modification time match the ones recorded in it.
+ */
+class baked_bundle
+{
+public:
+    static std::string path_for(const std::string &bundle_path)
+    {
+        return bundle_path + ".xbk";
+    }
+
+    /**
+     * Writes resources, fully decoded from the bundle at bundle_path, to path.
+     */
+    static void write(const std::string &path, const std::string &bundle_path,
+                      const std::vector<std::shared_ptr<base_data_resource>> &resources);
+
+    /**
+     * @return the bake at path, or null if it is missing, stale or from another version
+     */
+    static std::unique_ptr<baked_bundle> open(const std::string &path, const std::string &bundle_path);
+
+    const baked_header &header() const
+    {
+        return *reinterpret_cast<const baked_header *>(m_base);
+    }
+
+    template<typename T>
+    const T *table(const baked_table &table) const
+    {
+        return reinterpret_cast<const T *>(m_base + table.offset);
+    }
+
+    std::string string(const baked_string &string) const;
+
+    /**
+     * Rebuilds the texture packs and solid lists.
+     *
+     * @param bundle source of texture payloads
+     */
+    std::vector<std::shared_ptr<base_data_resource>> resources(std::shared_ptr<const byte_source> bundle,
+                                                               std::shared_ptr<resource_cache> cache) const;
+
+private:
+    std::shared_ptr<const byte_source> m_source;
+    std::vector<unsigned char> m_copy; // when the file can't be mapped
+    const unsigned char *m_base;
+
+    bool valid() const;
+};
+
+
+#endif //EXPLORER_BAKED_BUNDLE_HPP
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include "bundle_diff.hpp"
+#include "chunk_stream.hpp"
+#include "solid_list_stream.hpp"
+#include "texture_pack_stream.hpp"
+
+static void add_entry(bundle_digest &digest, const std::string &key, bundle_entry entry)
+{
+    auto unique_key = key;
+
+    for (auto n = 2; digest.count(unique_key); n++)
+    {
+        unique_key = string_format("%s #%d", key.c_str(), n);
+    }
+
+    digest[unique_key] = std::move(entry);
+}
+
+/**
+ * Hash of a chunk whose children are hashed already: the bytes between the
+ * children are hashed and the children's hashes folded in, so that no byte
+ * is read twice.
+ */
+static unsigned long long hash_around(chunk_stream &cstream, const chunk &chunk,
+                                      const std::vector<std::pair<std::string, bundle_entry>> &children)
+{
+    std::vector<const bundle_entry *> sorted;
+
+    for (auto &child : children)
+    {
+        sorted.push_back(&child.second);
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](const bundle_entry *a, const bundle_entry *b)
+    {
+        return a->offset < b->offset;
+    });
+
+    unsigned long long hash = 0;
+    auto position = chunk.offset;
+
+    for (auto child : sorted)
+    {
+        auto child_offset = std::min(std::max(child->offset, position), chunk.end_offset);
+
+        if (child_offset > position)
+        {
+            hash = hash_bytes(&hash, sizeof(hash), cstream.hash_range(position, child_offset - position));
+        }
+
+        hash = hash_bytes(&child->content_hash, sizeof(child->content_hash), hash);
+        position = std::max(position, std::min(child->offset + child->length, chunk.end_offset));
+    }
+
+    if (chunk.end_offset > position)
+    {
+        hash = hash_bytes(&hash, sizeof(hash), cstream.hash_range(position, chunk.end_offset - position));
+    }
+
+    return hash;
+}
+
+bundle_digest digest_bundle(const std::string &filename)
+{
+    chunk_stream cstream(byte_source::open(filename));
+    cstream.set_headers_only(true);
+
+    bundle_digest digest;
+    std::map<unsigned int, unsigned int> ordinals;
+
+    while (cstream.data_remaining())
+    {
+        auto chunk = cstream.read_chunk();
+        auto resource_count = cstream.resources.size();
+
+        cstream.process_chunk(chunk);
+
+        std::shared_ptr<base_data_resource> resource;
+        std::vector<std::pair<std::string, bundle_entry>> children;
+
+        if (cstream.resources.size() > resource_count)
+        {
+            resource = cstream.resources.back();
+        }
+
+        if (auto tp = std::dynamic_pointer_cast<texture_pack>(resource))
+        {
+            for (auto &texture : tp->textures)
+            {
+                if (!texture) continue;
+
+                // The payload alone misses format changes, so fold the header fields in.
+                unsigned int fields[] = {texture->width, texture->height, texture->mipmaps, texture->dds_type};
+                auto content_hash = hash_bytes(fields, sizeof(fields),
+                                               cstream.hash_range(texture->source_offset, texture->data_size));
+
+                children.emplace_back(string_format("texture %08X", texture->texture_hash),
+                                      bundle_entry{string_format("texture %s", texture->name.c_str()),
+                                                   texture->source_offset, texture->data_size, content_hash});
+            }
+
+            add_entry(digest, string_format("pack %08X", tp->hash),
+                      {string_format("texture pack %s", tp->name.c_str()), chunk->offset, chunk->length,
+                       hash_around(cstream, *chunk, children)});
+        } else if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+        {
+            for (auto &object : slp->solid_objects)
+            {
+                children.emplace_back(string_format("object %08X", object.hash),
+                                      bundle_entry{string_format("object %s", object.name.c_str()),
+                                                   object.source_offset, object.source_length,
+                                                   cstream.hash_range(object.source_offset, object.source_length)});
+            }
+
+            add_entry(digest, string_format("solid list %s", slp->pipeline_path.c_str()),
+                      {string_format("solid list %s", slp->pipeline_path.c_str()), chunk->offset, chunk->length,
+                       hash_around(cstream, *chunk, children)});
+        } else
+        {
+            add_entry(digest, string_format("chunk %08X #%u", chunk->type, ordinals[chunk->type]++),
+                      {string_format("chunk %08X", chunk->type), chunk->offset, chunk->length,
+                       cstream.hash_range(chunk->offset, chunk->length)});
+        }
+
+        for (auto &child : children)
+        {
+            add_entry(digest, child.first, std::move(child.second));
+        }
+
+        cstream.skip_chunk(chunk);
+    }
+
+    return digest;
+}
+
+bundle_diff_counts write_bundle_diff(std::ostream &stream, const bundle_digest &before, const bundle_digest &after)
+{
+    bundle_diff_counts counts;
+
+    // Both maps are sorted by key, so one merge pass pairs them up.
+    auto a = before.begin();
+    auto b = after.begin();
+
+    while (a != before.end() || b != after.end())
+    {
+        if (b == after.end() || (a != before.end() && a->first < b->first))
+        {
+            write_line(stream, string_format("- %-24s %s [%u bytes @ %08X]", a->first.c_str(),
+                                             a->second.description.c_str(), a->second.length, a->second.offset));
+            counts.removed++;
+            ++a;
+        } else if (a == before.end() || b->first < a->first)
+        {
+            write_line(stream, string_format("+ %-24s %s [%u bytes @ %08X]", b->first.c_str(),
+                                             b->second.description.c_str(), b->second.length, b->second.offset));
+            counts.added++;
+            ++b;
+        } else
+        {
+            if (a->second.content_hash != b->second.content_hash || a->second.length != b->second.length)
+            {
+                write_line(stream, string_format("* %-24s %s [%u -> %u bytes]", b->first.c_str(),
+                                                 b->second.description.c_str(), a->second.length,
+                                                 b->second.length));
+                counts.modified++;
+            } else
+            {
+                counts.unchanged++;
+            }
+
+            ++a;
+            ++b;
+        }
+    }
+
+    return counts;
+}
@@ -0,0 +1,43 @@
+#ifndef EXPLORER_BUNDLE_DIFF_HPP
+#define EXPLORER_BUNDLE_DIFF_HPP
+
+#include <map>
+#include <ostream>
+#include <string>
+
+/**
+ * One resource of a bundle, as compared by diff.
+ */
+struct bundle_entry
+{
+    std::string description;
+    unsigned int offset;
+    unsigned int length;
+    unsigned long long content_hash;
+};
+
+/**
+ * Resources of a bundle keyed by identity: "pack <hash>", "texture <hash>",
+ * "solid list <path>", "object <hash>", or "chunk <type> #<ordinal>" for other
+ * top-level chunks. Repeated identities get a " #n" suffix.
+ */
+typedef std::map<std::string, bundle_entry> bundle_digest;
+
+/**
+ * Reads a bundle's resource headers and hashes each resource's bytes in place.
+ * Payloads are not decoded.
+ */
+bundle_digest digest_bundle(const std::string &filename);
+
+struct bundle_diff_counts
+{
+    size_t added = 0, removed = 0, modified = 0, unchanged = 0;
+};
+
+/**
+ * Writes one line per added (+), removed (-) and modified (*) resource.
+ */
+bundle_diff_counts write_bundle_diff(std::ostream &stream, const bundle_digest &before, const bundle_digest &after);
+
+
+#endif //EXPLORER_BUNDLE_DIFF_HPP
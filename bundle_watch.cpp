@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+#include "bundle_watch.hpp"
+#include "chunk_stream.hpp"
+#include "thread_pool.hpp"
+
+std::vector<chunk_fingerprint> fingerprint_chunks(const byte_source &source)
+{
+    std::vector<chunk_fingerprint> chunks;
+    size_t position = 0;
+
+    while (position + sizeof(chunk_header) <= source.size())
+    {
+        chunk_header header{};
+        source.read_at(&header, sizeof(header), position);
+
+        auto offset = position + sizeof(chunk_header);
+
+        if (offset + header.length > source.size())
+        {
+            throw std::runtime_error(string_format(
+                    "Chunk %08X @ %08zX runs past the end of %s.", header.type, offset, source.path().c_str()));
+        }
+
+        chunks.push_back({header.type, (unsigned int) offset, header.length, 0});
+        position = offset + header.length;
+    }
+
+    parallel_for(chunks.size(), [&](size_t i)
+    {
+        auto &chunk = chunks[i];
+
+        if (source.data() != nullptr)
+        {
+            chunk.hash = hash_bytes(source.data() + chunk.offset, chunk.length);
+        } else
+        {
+            auto bytes = source.read_vector_at<char>(chunk.offset, chunk.length);
+            chunk.hash = hash_bytes(bytes->data(), bytes->size());
+        }
+    });
+
+    return chunks;
+}
+
+std::vector<chunk_fingerprint> changed_chunks(const std::vector<chunk_fingerprint> &previous,
+                                              const std::vector<chunk_fingerprint> &current)
+{
+    std::map<unsigned int, std::vector<const chunk_fingerprint *>> by_type;
+
+    for (auto &chunk : previous)
+    {
+        by_type[chunk.type].push_back(&chunk);
+    }
+
+    std::map<unsigned int, size_t> ordinals;
+    std::vector<chunk_fingerprint> changed;
+
+    for (auto &chunk : current)
+    {
+        auto &candidates = by_type[chunk.type];
+        auto ordinal = ordinals[chunk.type]++;
+
+        if (ordinal >= candidates.size() || candidates[ordinal]->length != chunk.length
+            || candidates[ordinal]->hash != chunk.hash)
+        {
+            changed.push_back(chunk);
+        }
+    }
+
+    return changed;
+}
+
+bool is_bundle_path(const std::string &path)
+{
+    auto extension = boost::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    return extension == ".bin" || extension == ".bun";
+}
+
+static volatile sig_atomic_t g_stop_requested = 0;
+static int g_stop_pipe[2] = {-1, -1};
+
+/**
+ * Signal handler: flags the stop and wakes wait() through the pipe, whichever
+ * thread the signal lands on.
+ */
+static void request_stop(int)
+{
+    g_stop_requested = 1;
+
+    auto saved_errno = errno;
+    auto written = ::write(g_stop_pipe[1], "", 1);
+    (void) written;
+    errno = saved_errno;
+}
+
+bundle_watcher::bundle_watcher()
+{
+    m_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+
+    if (m_fd < 0)
+    {
+        throw std::runtime_error(string_format("inotify_init1() failed: %s", strerror(errno)));
+    }
+
+    if (pipe2(g_stop_pipe, O_CLOEXEC | O_NONBLOCK) < 0)
+    {
+        auto error = errno;
+        close(m_fd);
+        throw std::runtime_error(string_format("pipe2() failed: %s", strerror(error)));
+    }
+
+    g_stop_requested = 0;
+
+    struct sigaction action{};
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGINT, &action, &m_previous_int);
+    sigaction(SIGTERM, &action, &m_previous_term);
+}
+
+bundle_watcher::~bundle_watcher()
+{
+    sigaction(SIGINT, &m_previous_int, nullptr);
+    sigaction(SIGTERM, &m_previous_term, nullptr);
+
+    close(g_stop_pipe[0]);
+    close(g_stop_pipe[1]);
+    g_stop_pipe[0] = g_stop_pipe[1] = -1;
+
+    for (auto &directory : m_directories)
+    {
+        inotify_rm_watch(m_fd, directory.first);
+    }
+
+    close(m_fd);
+}
+
+bool bundle_watcher::stop_requested() const
+{
+    return g_stop_requested != 0;
+}
+
+void bundle_watcher::add(const std::string &path)
+{
+    auto all_bundles = boost::filesystem::is_directory(path);
+
+    if (!all_bundles && !boost::filesystem::is_regular_file(path))
+    {
+        throw std::runtime_error(string_format("Not a file or directory: %s", path.c_str()));
+    }
+
+    auto directory = all_bundles ? boost::filesystem::path(path) : boost::filesystem::path(path).parent_path();
+
+    // Writes in place end with IN_CLOSE_WRITE, replacements with IN_MOVED_TO.
+    auto wd = inotify_add_watch(m_fd, directory.empty() ? "." : directory.string().c_str(),
+                                IN_CLOSE_WRITE | IN_MOVED_TO);
+
+    if (wd < 0)
+    {
+        throw std::runtime_error(string_format("Can't watch %s: %s", directory.string().c_str(), strerror(errno)));
+    }
+
+    // Watching the same directory twice yields the same descriptor. The path
+    // is kept as given so reported paths match the ones passed in.
+    auto &watched = m_directories[wd];
+    watched.path = directory.string();
+
+    if (all_bundles)
+    {
+        watched.all_bundles = true;
+    } else
+    {
+        watched.names.insert(boost::filesystem::path(path).filename().string());
+    }
+}
+
+std::vector<std::string> bundle_watcher::wait(int settle_ms)
+{
+    std::set<std::string> written;
+    pollfd descriptors[] = {{m_fd, POLLIN, 0}, {g_stop_pipe[0], POLLIN, 0}};
+
+    while (!stop_requested())
+    {
+        auto ready = poll(descriptors, 2, written.empty() ? -1 : settle_ms);
+
+        if (ready < 0)
+        {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(string_format("poll() failed: %s", strerror(errno)));
+        }
+
+        if (ready == 0)
+        {
+            return std::vector<std::string>(written.begin(), written.end());
+        }
+
+        if (descriptors[0].revents != 0)
+        {
+            read_events(written);
+        }
+    }
+
+    return {};
+}
+
+void bundle_watcher::read_events(std::set<std::string> &written)
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while (true)
+    {
+        auto length = ::read(m_fd, buffer, sizeof(buffer));
+
+        if (length < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) return;
+            throw std::runtime_error(string_format("Reading inotify events failed: %s", strerror(errno)));
+        }
+
+        for (auto position = 0l; position < length;)
+        {
+            auto event = reinterpret_cast<const inotify_event *>(buffer + position);
+            position += sizeof(inotify_event) + event->len;
+
+            auto directory = m_directories.find(event->wd);
+
+            if (event->len == 0 || directory == m_directories.end())
+            {
+                continue;
+            }
+
+            std::string name(event->name);
+            auto &watched = directory->second;
+
+            if (watched.names.count(name) || (watched.all_bundles && is_bundle_path(name)))
+            {
+                written.insert((boost::filesystem::path(watched.path) / name).string());
+            }
+        }
+    }
+}
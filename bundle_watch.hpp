@@ -0,0 +1,97 @@
+#ifndef EXPLORER_BUNDLE_WATCH_HPP
+#define EXPLORER_BUNDLE_WATCH_HPP
+
+#include <csignal>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "byte_source.hpp"
+
+/**
+ * Identity and content hash of one top-level chunk of a bundle. offset and
+ * length describe the payload, as in struct chunk.
+ */
+struct chunk_fingerprint
+{
+    unsigned int type;
+    unsigned int offset;
+    unsigned int length;
+    unsigned long long hash;
+};
+
+/**
+ * Hashes every top-level chunk of source in place, in parallel.
+ * Throws if the last chunk runs past the end, as in a half-written file.
+ */
+std::vector<chunk_fingerprint> fingerprint_chunks(const byte_source &source);
+
+/**
+ * Chunks of current that are new or whose bytes differ from previous. Chunks
+ * are matched by type and ordinal among chunks of that type, so a chunk that
+ * only moved because an earlier one changed size is not reported.
+ */
+std::vector<chunk_fingerprint> changed_chunks(const std::vector<chunk_fingerprint> &previous,
+                                              const std::vector<chunk_fingerprint> &current);
+
+/**
+ * @return whether path has a bundle extension (.BIN or .BUN, any case)
+ */
+bool is_bundle_path(const std::string &path);
+
+/**
+ * Reports bundles that have been written, using inotify.
+ *
+ * Directories are watched rather than the files themselves, so bundles that
+ * are replaced by a rename are still seen. While a watcher exists, SIGINT and
+ * SIGTERM end its wait() instead of the process; only one watcher may exist
+ * at a time.
+ */
+class bundle_watcher
+{
+public:
+    bundle_watcher();
+
+    ~bundle_watcher();
+
+    /**
+     * Watches a bundle, or every bundle directly inside a directory.
+     */
+    void add(const std::string &path);
+
+    /**
+     * Blocks until a watched bundle is written, then keeps collecting until
+     * settle_ms pass without another write.
+     *
+     * @return paths of the bundles written, sorted; empty once a stop is requested
+     */
+    std::vector<std::string> wait(int settle_ms);
+
+    /**
+     * @return whether SIGINT or SIGTERM has arrived
+     */
+    bool stop_requested() const;
+
+    bundle_watcher(const bundle_watcher &) = delete;
+
+    bundle_watcher &operator=(const bundle_watcher &) = delete;
+
+private:
+    struct watched_directory
+    {
+        std::string path;
+        bool all_bundles = false;
+        std::set<std::string> names;
+    };
+
+    int m_fd;
+    std::map<int, watched_directory> m_directories;
+    struct sigaction m_previous_int;
+    struct sigaction m_previous_term;
+
+    void read_events(std::set<std::string> &written);
+};
+
+
+#endif //EXPLORER_BUNDLE_WATCH_HPP
@@ -0,0 +1,99 @@
+#include "byte_source.hpp"
+#include "utils.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::shared_ptr<const byte_source> byte_source::open(const std::string &path, bool map)
+{
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        throw std::runtime_error(string_format("Can't open %s: %s", path.c_str(), strerror(errno)));
+    }
+
+    struct stat st{};
+
+    if (fstat(fd, &st) == -1)
+    {
+        auto error = errno;
+        close(fd);
+        throw std::runtime_error(string_format("Can't stat %s: %s", path.c_str(), strerror(error)));
+    }
+
+    return std::shared_ptr<const byte_source>(new byte_source(path, fd, (size_t) st.st_size, map));
+}
+
+static std::atomic<unsigned long long> next_source_id(1);
+
+byte_source::byte_source(std::string path, int fd, size_t size, bool map) : m_path(std::move(path)),
+                                                                            m_id(next_source_id++),
+                                                                            m_fd(fd),
+                                                                            m_size(size),
+                                                                            m_data(nullptr),
+                                                                            m_bytes_read(0)
+{
+    if (m_size == 0 || !map)
+    {
+        return;
+    }
+
+    auto mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+
+    if (mapping != MAP_FAILED)
+    {
+        m_data = (const unsigned char *) mapping;
+    }
+}
+
+byte_source::~byte_source()
+{
+    if (m_data != nullptr)
+    {
+        munmap((void *) m_data, m_size);
+    }
+
+    close(m_fd);
+}
+
+void byte_source::read_at(void *buf, size_t size, size_t offset) const
+{
+    if (offset > m_size || size > m_size - offset)
+    {
+        throw std::runtime_error(string_format("Read of %zu bytes at %08zX passes the end of %s (%zu bytes)", size,
+                                               offset, m_path.c_str(), m_size));
+    }
+
+    m_bytes_read.fetch_add(size, std::memory_order_relaxed);
+
+    if (m_data != nullptr)
+    {
+        memcpy(buf, m_data + offset, size);
+        return;
+    }
+
+    auto out = (char *) buf;
+
+    while (size > 0)
+    {
+        auto count = pread(m_fd, out, size, (off_t) offset);
+
+        if (count == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (count <= 0)
+        {
+            throw std::runtime_error(string_format("Failed to read %zu bytes at %08zX from %s", size, offset,
+                                                   m_path.c_str()));
+        }
+
+        out += count;
+        offset += count;
+        size -= count;
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef EXPLORER_BYTE_SOURCE_HPP
+#define EXPLORER_BYTE_SOURCE_HPP
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Immutable, read-only view of a whole file.
+ *
+ * The file is mapped into memory when possible; otherwise reads fall back to
+ * pread() on the open descriptor. Neither path has a shared file position, so
+ * any number of threads may call read_at() on one source at once without
+ * locking. Readers keep their own position (see chunk_stream) and share the
+ * source through a shared_ptr.
+ */
+class byte_source
+{
+public:
+    /**
+     * @param map false to always read through pread(), for files that may be
+     *            truncated while open: a read past the new end then throws
+     *            instead of raising SIGBUS
+     * @throws std::runtime_error if the file can't be opened
+     */
+    static std::shared_ptr<const byte_source> open(const std::string &path, bool map = true);
+
+    ~byte_source();
+
+    byte_source(const byte_source &) = delete;
+
+    byte_source &operator=(const byte_source &) = delete;
+
+    const std::string &path() const
+    {
+        return m_path;
+    }
+
+    /**
+     * Number unique to this opening of the file for the life of the process.
+     * Unlike the source's address, it is never reused after the source is
+     * freed, so caches key on it.
+     */
+    unsigned long long id() const
+    {
+        return m_id;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    /**
+     * @return the mapped file, or null when reads go through pread()
+     */
+    const unsigned char *data() const
+    {
+        return m_data;
+    }
+
+    /**
+     * Copies [offset, offset + size) into buf.
+     *
+     * @throws std::runtime_error if the range is outside the file or the read fails
+     */
+    void read_at(void *buf, size_t size, size_t offset) const;
+
+    /**
+     * @return total bytes copied out by read_at() so far
+     */
+    unsigned long long bytes_read() const
+    {
+        return m_bytes_read.load(std::memory_order_relaxed);
+    }
+
+    template<typename T>
+    std::shared_ptr<std::vector<T>> read_vector_at(size_t offset, size_t count) const
+    {
+        auto result = std::make_shared<std::vector<T>>(count);
+        read_at(result->data(), count * sizeof(T), offset);
+
+        return result;
+    }
+
+private:
+    byte_source(std::string path, int fd, size_t size, bool map);
+
+    std::string m_path;
+    unsigned long long m_id;
+    int m_fd;
+    size_t m_size;
+    const unsigned char *m_data;
+    mutable std::atomic<unsigned long long> m_bytes_read;
+};
+
+
+#endif //EXPLORER_BYTE_SOURCE_HPP
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <unistd.h>
+#include "chunk_store.hpp"
+#include "chunk_tree.hpp"
+#include "texture_pack_stream.hpp"
+#include "thread_pool.hpp"
+
+const unsigned int kTexturePackChunk = 0xB3300000;
+
+static const char *kStoreManifestHeader = "# explorer store manifest 1";
+
+static const char kHexDigits[] = "0123456789abcdef";
+
+static int hex_value(char digit)
+{
+    auto value = strchr(kHexDigits, tolower((unsigned char) digit));
+
+    if (digit == 0 || value == nullptr)
+    {
+        throw std::runtime_error(string_format("Bad hex digit '%c' in store manifest.", digit));
+    }
+
+    return (int) (value - kHexDigits);
+}
+
+std::string store_key::hex() const
+{
+    return string_format("%016llx%016llx", high, low);
+}
+
+store_key key_for(const void *data, size_t size)
+{
+    return store_key{hash_bytes(data, size, 0x9E3779B97F4A7C15ull), hash_bytes(data, size)};
+}
+
+std::vector<store_piece> split_bundle(const std::shared_ptr<const byte_source> &source)
+{
+    std::vector<size_t> cuts{0, source->size()};
+    chunk_stream cstream(source);
+    cstream.set_headers_only(true);
+
+    // The walker throws on a chunk that overruns its parent, so a damaged
+    // bundle fails here instead of being cut at wrapped offsets.
+    for (auto &entry : chunk_tree(cstream, 0, (unsigned int) source->size()))
+    {
+        if (entry.chunk.end_offset > source->size())
+        {
+            throw std::runtime_error(string_format("Chunk %08X @ %08X runs past the end of %s.", entry.chunk.type,
+                                                   entry.chunk.offset, source->path().c_str()));
+        }
+
+        cuts.push_back(entry.chunk.offset - sizeof(chunk_header));
+        cuts.push_back(entry.chunk.offset);
+        cuts.push_back(entry.chunk.end_offset);
+
+        // The texture data chunk is one leaf; cut it at each texture too, so
+        // that a changed texture doesn't take its pack's other textures along.
+        if (entry.depth == 0 && entry.chunk.type == kTexturePackChunk)
+        {
+            cstream.process_chunk(std::make_shared<chunk>(entry.chunk));
+        }
+    }
+
+    for (auto &resource : cstream.resources)
+    {
+        if (auto tp = std::dynamic_pointer_cast<texture_pack>(resource))
+        {
+            for (auto &texture : tp->textures)
+            {
+                if (!texture) continue;
+
+                cuts.push_back(texture->source_offset);
+                cuts.push_back((size_t) texture->source_offset + texture->data_size);
+            }
+        }
+    }
+
+    for (auto &cut : cuts)
+    {
+        cut = std::min(cut, source->size());
+    }
+
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+    std::vector<store_piece> pieces;
+
+    for (size_t i = 1; i < cuts.size(); i++)
+    {
+        pieces.push_back({cuts[i - 1], cuts[i] - cuts[i - 1], store_key{0, 0}});
+    }
+
+    return pieces;
+}
+
+chunk_store::chunk_store(std::string directory) : m_directory(std::move(directory))
+{}
+
+boost::filesystem::path chunk_store::object_path(const store_key &key) const
+{
+    auto hex = key.hex();
+
+    return m_directory / "objects" / hex.substr(0, 2) / hex.substr(2);
+}
+
+boost::filesystem::path chunk_store::manifest_path(const std::string &name) const
+{
+    return m_directory / "bundles" / (name + ".manifest");
+}
+
+std::string chunk_store::name_for(const std::string &bundle_path)
+{
+    boost::filesystem::path name;
+
+    for (auto &part : boost::filesystem::path(bundle_path).relative_path())
+    {
+        if (part != "." && part != "..")
+        {
+            name /= part;
+        }
+    }
+
+    return name.generic_string();
+}
+
+ingest_stats chunk_store::ingest(const std::string &bundle_path, const std::string &name) const
+{
+    auto source = byte_source::open(bundle_path);
+    auto pieces = split_bundle(source);
+
+    ingest_stats stats;
+    std::mutex mutex;
+    std::set<std::pair<unsigned long long, unsigned long long>> claimed;
+    static std::atomic<unsigned int> temp_counter(0);
+
+    // Each worker hashes a piece and writes it if it's new, so hashing and
+    // writing overlap across workers.
+    parallel_for(pieces.size(), [&](size_t i)
+    {
+        auto &piece = pieces[i];
+
+        if (piece.length <= kInlineLimit)
+        {
+            return;
+        }
+
+        std::shared_ptr<std::vector<unsigned char>> copy;
+        const unsigned char *data;
+
+        if (source->data() != nullptr)
+        {
+            data = source->data() + piece.offset;
+        } else
+        {
+            copy = source->read_vector_at<unsigned char>(piece.offset, piece.length);
+            data = copy->data();
+        }
+
+        piece.key = key_for(data, piece.length);
+
+        {
+            // Identical pieces of one bundle are written once.
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (!claimed.insert({piece.key.high, piece.key.low}).second)
+            {
+                return;
+            }
+        }
+
+        auto path = object_path(piece.key);
+
+        if (boost::filesystem::exists(path))
+        {
+            if (boost::filesystem::file_size(path) != piece.length)
+            {
+                throw std::runtime_error(string_format("Stored piece %s has the wrong size.", piece.key.hex().c_str()));
+            }
+
+            return;
+        }
+
+        boost::filesystem::create_directories(path.parent_path());
+
+        // Written under a unique name and renamed, so concurrent ingests
+        // never expose a partial piece.
+        auto temp_path = path.string() + string_format(".%d-%u.tmp", (int) getpid(), temp_counter++);
+
+        {
+            std::ofstream stream(temp_path, std::ios::trunc | std::ios::binary);
+            stream.write((const char *) data, piece.length);
+
+            if (!stream)
+            {
+                throw std::runtime_error(string_format("Can't write %s.", temp_path.c_str()));
+            }
+        }
+
+        boost::filesystem::rename(temp_path, path);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.new_pieces++;
+        stats.new_bytes += piece.length;
+    });
+
+    boost::filesystem::create_directories(manifest_path(name).parent_path());
+
+    auto path = manifest_path(name).string();
+    auto temp_path = path + ".tmp";
+
+    {
+        simple_filewriter sfw(temp_path);
+        std::string literal;
+
+        sfw.write_line(kStoreManifestHeader);
+        sfw.write_line(string_format("size %zu", source->size()));
+
+        // <key> <length> for stored pieces, "= <hex bytes>" for runs of short ones
+        for (auto &piece : pieces)
+        {
+            stats.pieces++;
+            stats.bytes += piece.length;
+
+            if (piece.length <= kInlineLimit)
+            {
+                std::vector<unsigned char> bytes(piece.length);
+                source->read_at(bytes.data(), bytes.size(), piece.offset);
+
+                for (auto byte : bytes)
+                {
+                    literal += kHexDigits[byte >> 4];
+                    literal += kHexDigits[byte & 15];
+                }
+
+                stats.inline_bytes += piece.length;
+                continue;
+            }
+
+            if (!literal.empty())
+            {
+                sfw.write_line("= " + literal);
+                literal.clear();
+            }
+
+            sfw.write_line(string_format("%s %zu", piece.key.hex().c_str(), piece.length));
+        }
+
+        if (!literal.empty())
+        {
+            sfw.write_line("= " + literal);
+        }
+    }
+
+    boost::filesystem::rename(temp_path, path);
+
+    return stats;
+}
+
+void chunk_store::restore(const std::string &name, const std::string &output_path) const
+{
+    std::ifstream manifest(manifest_path(name).string());
+    std::string line;
+    size_t size = 0;
+
+    if (!std::getline(manifest, line) || line != kStoreManifestHeader
+        || !std::getline(manifest, line) || sscanf(line.c_str(), "size %zu", &size) != 1)
+    {
+        throw std::runtime_error(string_format("No bundle %s in the store.", name.c_str()));
+    }
+
+    auto temp_path = output_path + ".tmp";
+    std::ofstream output(temp_path, std::ios::trunc | std::ios::binary);
+    size_t written = 0;
+
+    try
+    {
+        while (std::getline(manifest, line))
+        {
+            std::vector<char> bytes;
+
+            if (line.compare(0, 2, "= ") == 0)
+            {
+                for (size_t i = 2; i + 1 < line.size(); i += 2)
+                {
+                    bytes.push_back((char) (hex_value(line[i]) << 4 | hex_value(line[i + 1])));
+                }
+            } else
+            {
+                store_key key{};
+                size_t length = 0;
+
+                if (sscanf(line.c_str(), "%16llx%16llx %zu", &key.high, &key.low, &length) != 3)
+                {
+                    throw std::runtime_error(string_format("Bad manifest line for %s: %s", name.c_str(), line.c_str()));
+                }
+
+                std::ifstream piece(object_path(key).string(), std::ios::binary);
+                bytes.resize(length);
+
+                if (!piece.read(bytes.data(), length) || piece.peek() != EOF || key_for(bytes.data(), length) != key)
+                {
+                    throw std::runtime_error(string_format("Stored piece %s is missing or damaged.", key.hex().c_str()));
+                }
+            }
+
+            output.write(bytes.data(), bytes.size());
+            written += bytes.size();
+        }
+    } catch (...)
+    {
+        output.close();
+        boost::filesystem::remove(temp_path);
+        throw;
+    }
+
+    output.close();
+
+    if (!output || written != size)
+    {
+        boost::filesystem::remove(temp_path);
+        throw std::runtime_error(string_format("Restored %zu of %zu bytes of %s.", written, size, name.c_str()));
+    }
+
+    boost::filesystem::rename(temp_path, output_path);
+}
+
+std::vector<std::string> chunk_store::bundles() const
+{
+    std::vector<std::string> names;
+    auto directory = m_directory / "bundles";
+
+    if (!boost::filesystem::is_directory(directory))
+    {
+        return names;
+    }
+
+    for (auto &entry : boost::filesystem::recursive_directory_iterator(directory))
+    {
+        auto path = entry.path().generic_string();
+        auto prefix = directory.generic_string() + "/";
+
+        if (boost::filesystem::is_regular_file(entry.path()) && entry.path().extension() == ".manifest")
+        {
+            names.push_back(path.substr(prefix.size(), path.size() - prefix.size() - strlen(".manifest")));
+        }
+    }
+
+    std::sort(names.begin(), names.end());
+
+    return names;
+}
@@ -0,0 +1,109 @@
+#ifndef EXPLORER_CHUNK_STORE_HPP
+#define EXPLORER_CHUNK_STORE_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "byte_source.hpp"
+
+/**
+ * 128-bit content key of a stored piece: two XXH64 hashes with different seeds.
+ */
+struct store_key
+{
+    unsigned long long high;
+    unsigned long long low;
+
+    bool operator==(const store_key &other) const
+    {
+        return high == other.high && low == other.low;
+    }
+
+    bool operator!=(const store_key &other) const
+    {
+        return !(*this == other);
+    }
+
+    std::string hex() const;
+};
+
+store_key key_for(const void *data, size_t size);
+
+/**
+ * A byte range of a bundle. Ranges of at most chunk_store::kInlineLimit bytes
+ * are kept in the manifest instead of being stored.
+ */
+struct store_piece
+{
+    size_t offset;
+    size_t length;
+    store_key key;
+};
+
+/**
+ * Splits source into ranges that cover it exactly, cut at every chunk header
+ * and payload boundary and at the payload of every texture.
+ */
+std::vector<store_piece> split_bundle(const std::shared_ptr<const byte_source> &source);
+
+struct ingest_stats
+{
+    size_t pieces = 0;
+    size_t new_pieces = 0;
+    unsigned long long bytes = 0;
+    unsigned long long new_bytes = 0;
+    unsigned long long inline_bytes = 0;
+};
+
+/**
+ * Directory of bundle pieces stored once under their content key, and of
+ * per-bundle manifests listing the pieces that rebuild each bundle:
+ *
+ *     objects/<first 2 key digits>/<other 30 key digits>
+ *     bundles/<bundle path>.manifest
+ *
+ * Bundles that share most of their chunks, such as builds of the same game,
+ * cost little more than one.
+ */
+class chunk_store
+{
+public:
+    static const size_t kInlineLimit = 128;
+
+    explicit chunk_store(std::string directory);
+
+    /**
+     * Stores the pieces of a bundle that aren't stored yet and records its
+     * manifest under name. Pieces are hashed and written in parallel.
+     */
+    ingest_stats ingest(const std::string &bundle_path, const std::string &name) const;
+
+    /**
+     * Rebuilds the bundle recorded under name. Every piece is verified
+     * against its key.
+     *
+     * @throws std::runtime_error if the bundle or a piece is missing or damaged
+     */
+    void restore(const std::string &name, const std::string &output_path) const;
+
+    /**
+     * @return names of the recorded bundles, sorted
+     */
+    std::vector<std::string> bundles() const;
+
+    /**
+     * @return manifest name for a bundle path: the relative path without "." or ".."
+     */
+    static std::string name_for(const std::string &bundle_path);
+
+private:
+    boost::filesystem::path m_directory;
+
+    boost::filesystem::path object_path(const store_key &key) const;
+
+    boost::filesystem::path manifest_path(const std::string &name) const;
+};
+
+
+#endif //EXPLORER_CHUNK_STORE_HPP
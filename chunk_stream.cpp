@@ -2,8 +2,10 @@
 #include "utils.hpp"
 #include "solid_list_stream.hpp"
 #include "texture_pack_stream.hpp"
+#include "trace.hpp"
 
 const unsigned int kSolidListChunk = 0x80134000;
+const unsigned int kTexturePackChunk = 0xB3300000;
 
 read_result chunk_stream::read(void *buf, size_t size)
 {
@@ -15,7 +17,7 @@ read_result chunk_stream::read(void *buf, size_t size)
                 this->m_streamPos, size));
     }
 
-    this->m_stream.read((char *) buf, size);
+    this->m_source->read_at(buf, size, (size_t) this->m_streamPos);
     this->m_streamPos += size;
 
     return RESULT_OK;
@@ -27,6 +29,14 @@ std::shared_ptr<chunk> chunk_stream::read_chunk()
 
     this->read(&header, sizeof(chunk_header));
 
+    // A length that runs past the end would also wrap end_offset around and
+    // send skip_chunk() back to this header.
+    if (this->m_streamPos + (long long) header.length > this->m_endPos)
+    {
+        throw std::runtime_error(string_format("Chunk %08X @ %08lX runs past the end of the stream.", header.type,
+                                               this->m_streamPos - (long) sizeof(chunk_header)));
+    }
+
     return std::make_shared<chunk>(header.type, header.length, this->m_streamPos);
 }
 
@@ -38,11 +48,9 @@ void chunk_stream::seek(int position, unsigned int direction)
 
     if (direction == 0)
     {
-        this->m_stream.seekg(position);
         this->m_streamPos = position;
     } else if (direction == 1)
     {
-        this->m_stream.seekg(position, std::ios::cur);
         this->m_streamPos += position;
     } else if (direction == 2)
     {
@@ -54,8 +62,7 @@ void chunk_stream::seek(int position, unsigned int direction)
             throw std::runtime_error("Can't seek before the beginning.");
         }
 
-        this->m_stream.seekg(position, std::ios::end);
-        this->m_streamPos = this->m_streamLength - position;
+        this->m_streamPos = this->m_endPos + position;
     }
 }
 
@@ -64,19 +71,39 @@ void chunk_stream::skip_chunk(std::shared_ptr<chunk> chunk)
     this->seek(chunk->end_offset, 0);
 }
 
+unsigned long long chunk_stream::hash_range(unsigned int offset, unsigned int length)
+{
+    if (m_source->data() != nullptr && offset + (unsigned long long) length <= (unsigned long long) m_endPos)
+    {
+        // Mapped source: hash in place.
+        this->seek(offset + length, 0);
+        return hash_bytes(m_source->data() + offset, length);
+    }
+
+    std::vector<char> buffer(length);
+
+    this->seek(offset, 0);
+    this->read(buffer.data(), length);
+
+    return hash_bytes(buffer.data(), buffer.size());
+}
+
 void chunk_stream::process_chunk(std::shared_ptr<chunk> chunk)
 {
+    TRACE_SCOPE_FMT("chunk_stream::process_chunk", "%08X @ %08X", chunk->type, chunk->offset);
+
     if (chunk->type == kSolidListChunk)
     {
-        auto sls = std::make_shared<solid_list_stream>(this, chunk);
+        auto sls = std::make_shared<solid_list_stream>(this, chunk, m_headers_only);
 
         if (auto np = std::dynamic_pointer_cast<base_data_resource>(sls->get())) {
             this->resources.push_back(np);
         }
 //        this->resources.push_back(std::dynamic_pointer_cast<std::shared_ptr<base_data_resource>>(sls->get()));
-    } else if (chunk->type == 0xB3300000)
+    } else if (chunk->type == kTexturePackChunk)
     {
-        auto tpk_stream = std::make_shared<texture_pack_stream>(this, chunk);
+        auto tpk_stream = std::make_shared<texture_pack_stream>(this, chunk,
+                                                                m_headers_only || m_object_filter != nullptr);
 
         if (auto np = std::dynamic_pointer_cast<base_data_resource>(tpk_stream->get())) {
             this->resources.push_back(np);
@@ -2,7 +2,11 @@
 #define EXPLORER_CHUNK_STREAM_HPP
 
 #include "utils.hpp"
-#include <fstream>
+#include "game_traits.hpp"
+#include "resource_cache.hpp"
+#include "byte_source.hpp"
+#include <functional>
+#include <memory>
 
 enum read_result
 {
@@ -17,6 +21,13 @@ public:
 
 class chunk_stream;
 
+class solid_object;
+
+/**
+ * Decides from its header whether a solid object's mesh is decoded.
+ */
+using object_filter = std::function<bool(const solid_object &)>;
+
 struct chunk
 {
     unsigned int type;
@@ -37,38 +48,45 @@ struct chunk
     }
 };
 
-struct PACK chunk_header
+struct chunk_header
 {
     unsigned int type;
     unsigned int length;
 };
 
+/**
+ * Cursor over a window of a byte_source.
+ *
+ * A chunk_stream only holds a position; the bytes come from the shared,
+ * immutable source. Substreams are independent cursors over the same source,
+ * so separate chunk_streams may be read from different threads at once. A
+ * single chunk_stream is not thread-safe.
+ */
 class chunk_stream
 {
 public:
-    explicit chunk_stream(std::istream &stream) : m_streamLength(0),
-                                                  m_streamPos(0),
-                                                  m_stream(stream)
+    explicit chunk_stream(std::shared_ptr<const byte_source> source) : m_source(std::move(source)),
+                                                                       m_streamPos(0),
+                                                                       m_headers_only(false)
     {
-        stream.seekg(0, std::ios::end);
-
-        m_streamLength = (long) stream.tellg();
+        m_streamLength = (long) m_source->size();
         m_endPos = m_streamLength;
-
-        stream.seekg(0);
     }
 
-    chunk_stream(std::istream &stream, unsigned int streamPos, unsigned int size) : m_streamLength(size),
-                                                                                    m_streamPos(streamPos),
-                                                                                    m_stream(stream)
+    chunk_stream(std::shared_ptr<const byte_source> source, unsigned int streamPos, unsigned int size) :
+            m_source(std::move(source)),
+            m_streamLength(size),
+            m_streamPos(streamPos),
+            m_headers_only(false)
     {
-        m_stream.seekg(streamPos);
         m_endPos = m_streamPos + m_streamLength;
     }
 
     std::shared_ptr<chunk_stream> substream(unsigned int pos, unsigned int size)
     {
-        return std::make_shared<chunk_stream>(m_stream, pos, size);
+        auto stream = std::make_shared<chunk_stream>(m_source, pos, size);
+        stream->set_cache(m_cache);
+        return stream;
     }
 
     read_result read(void *buf, size_t size);
@@ -105,18 +123,17 @@ public:
     /**
      * @param boundary
      */
-    void align_padding(std::shared_ptr<chunk> chunk)
+    void align_padding(chunk &chunk)
     {
         auto padding = 0;
         while (read<int>() == 0x11111111) padding += 4;
 
         m_streamPos -= 4;
-        m_stream.seekg(-4, std::ios::cur);
 
-        chunk->offset += padding;
-        chunk->length -= padding;
-        chunk->full_length -= padding;
-        chunk->end_offset = chunk->offset + chunk->length;
+        chunk.offset += padding;
+        chunk.length -= padding;
+        chunk.full_length -= padding;
+        chunk.end_offset = chunk.offset + chunk.length;
     }
 
     /**
@@ -130,6 +147,14 @@ public:
      */
     void skip_chunk(std::shared_ptr<chunk> chunk);
 
+    /**
+     * Hashes [offset, offset + length) with hash_bytes(). Moves the stream position.
+     *
+     * @param offset
+     * @param length
+     */
+    unsigned long long hash_range(unsigned int offset, unsigned int length);
+
     /**
      * @param chunk
      */
@@ -145,6 +170,52 @@ public:
         return m_streamLength;
     }
 
+    /**
+     * Cache that decoded payloads read from this stream are registered with.
+     * Null keeps every payload resident.
+     */
+    std::shared_ptr<resource_cache> cache()
+    {
+        return m_cache;
+    }
+
+    void set_cache(std::shared_ptr<resource_cache> cache)
+    {
+        m_cache = cache;
+    }
+
+    /**
+     * Makes process_chunk() read resource headers only and skip payloads.
+     */
+    void set_headers_only(bool headers_only)
+    {
+        m_headers_only = headers_only;
+    }
+
+    /**
+     * Makes process_chunk() decode only the meshes of objects that filter
+     * accepts; the others keep just their header. Texture payloads are then
+     * left unread until first used.
+     */
+    void set_object_filter(object_filter filter)
+    {
+        m_object_filter = std::move(filter);
+    }
+
+    const object_filter &get_object_filter() const
+    {
+        return m_object_filter;
+    }
+
+    /**
+     * The bytes this stream reads from. Loaders for evicted payloads hold on
+     * to it and read with byte_source::read_vector_at().
+     */
+    const std::shared_ptr<const byte_source> &source() const
+    {
+        return m_source;
+    }
+
     chunk_stream(const chunk_stream &stream) = delete;
 
     chunk_stream(const chunk_stream &&stream) = delete;
@@ -155,10 +226,13 @@ public:
 
     std::vector<std::shared_ptr<base_data_resource>> resources;
 private:
-    std::istream &m_stream;
+    std::shared_ptr<const byte_source> m_source;
     long m_streamLength;
     long m_streamPos;
     long m_endPos;
+    std::shared_ptr<resource_cache> m_cache;
+    bool m_headers_only;
+    object_filter m_object_filter;
 };
 
 
@@ -0,0 +1,185 @@
+#ifndef EXPLORER_CHUNK_TREE_HPP
+#define EXPLORER_CHUNK_TREE_HPP
+
+#include <array>
+#include <iterator>
+#include "chunk_stream.hpp"
+
+struct chunk_tree_entry
+{
+    unsigned int depth;
+    ::chunk chunk;
+};
+
+/**
+ * Lazy, depth-first walk over the chunks in [offset, offset + length) of a
+ * chunk_stream.
+ *
+ * The walk is iterative: the end offsets of the open parent chunks are kept
+ * on a fixed-size stack, so no memory is allocated and nesting depth does not
+ * consume call stack. Headers are only read when the walk advances, so
+ * breaking out of the loop early stops all I/O. While an entry is current the
+ * stream is positioned at the start of its payload and may be read freely;
+ * the walker re-seeks on its own when it advances.
+ *
+ *     chunk_tree tree(stream, chunk->offset, chunk->length);
+ *     for (auto &entry : tree)
+ *     {
+ *         if (entry.chunk.type == 0xB3300000) tree.skip_children();
+ *     }
+ */
+class chunk_tree
+{
+public:
+    static const unsigned int kMaxDepth = 32;
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = chunk_tree_entry;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const chunk_tree_entry *;
+        using reference = const chunk_tree_entry &;
+
+        explicit iterator(chunk_tree *tree) : m_tree(tree)
+        {}
+
+        reference operator*() const
+        {
+            return m_tree->m_current;
+        }
+
+        pointer operator->() const
+        {
+            return &m_tree->m_current;
+        }
+
+        iterator &operator++()
+        {
+            m_tree->advance();
+            return *this;
+        }
+
+        bool operator==(const iterator &other) const
+        {
+            return at_end() == other.at_end();
+        }
+
+        bool operator!=(const iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        chunk_tree *m_tree;
+
+        bool at_end() const
+        {
+            return m_tree == nullptr || m_tree->m_done;
+        }
+    };
+
+    chunk_tree(chunk_stream &stream, unsigned int offset, unsigned int length) :
+            m_stream(stream),
+            m_current{0, chunk(0, 0, 0)},
+            m_offset(offset),
+            m_depth(1),
+            m_started(false),
+            m_done(false),
+            m_skip(false)
+    {
+        m_ends[0] = (unsigned long long) offset + length;
+    }
+
+    iterator begin()
+    {
+        if (!m_started)
+        {
+            m_started = true;
+            load(m_offset);
+        }
+
+        return iterator(this);
+    }
+
+    iterator end()
+    {
+        return iterator(nullptr);
+    }
+
+    /**
+     * Don't descend into the current chunk; continue with its next sibling.
+     */
+    void skip_children()
+    {
+        m_skip = true;
+    }
+
+private:
+    chunk_stream &m_stream;
+    chunk_tree_entry m_current;
+    std::array<unsigned long long, kMaxDepth> m_ends;
+    unsigned int m_offset;
+    unsigned int m_depth;
+    bool m_started;
+    bool m_done;
+    bool m_skip;
+
+    void advance()
+    {
+        auto &current = m_current.chunk;
+
+        if (current.is_parent && !m_skip)
+        {
+            if (m_depth == kMaxDepth)
+            {
+                throw std::runtime_error(string_format(
+                        "Chunk %08X @ %08X is nested deeper than %u levels.", current.type, current.offset, kMaxDepth));
+            }
+
+            m_ends[m_depth++] = current.end_offset;
+            m_skip = false;
+            load(current.offset);
+        } else
+        {
+            m_skip = false;
+            load(current.end_offset);
+        }
+    }
+
+    void load(unsigned long long position)
+    {
+        // Close every parent we have walked off the end of. A parent with
+        // fewer than sizeof(chunk_header) bytes left has no more children.
+        while (m_depth > 0 && position + sizeof(chunk_header) > m_ends[m_depth - 1])
+        {
+            position = std::max(position, m_ends[--m_depth]);
+        }
+
+        if (m_depth == 0)
+        {
+            m_done = true;
+            return;
+        }
+
+        m_stream.seek((unsigned int) position, 0);
+        auto header = m_stream.read<chunk_header>();
+
+        // Computed in 64 bits so that a huge length can't wrap back to this
+        // position and loop forever.
+        auto end = position + sizeof(chunk_header) + header.length;
+
+        if (end <= position || end > m_ends[m_depth - 1])
+        {
+            throw std::runtime_error(string_format(
+                    "Chunk %08X @ %08llX runs past the end of its parent.", header.type, position));
+        }
+
+        m_current.depth = m_depth - 1;
+        m_current.chunk = chunk(header.type, header.length, (unsigned int) (position + sizeof(chunk_header)));
+    }
+};
+
+
+#endif //EXPLORER_CHUNK_TREE_HPP
@@ -0,0 +1,180 @@
+#include "compact_mesh.hpp"
+#include <cmath>
+
+template<typename T>
+static void put(std::string &out, const T &value)
+{
+    out.append((const char *) &value, sizeof(T));
+}
+
+static void put_string(std::string &out, const std::string &value)
+{
+    auto length = (uint16_t) std::min<size_t>(value.size(), 0xFFFF);
+    put(out, length);
+    out.append(value, 0, length);
+}
+
+static void put_varint(std::string &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += (char) (value | 0x80);
+        value >>= 7;
+    }
+
+    out += (char) value;
+}
+
+/**
+ * Quantizes value to 16 bits over [min, max]. Returns the error of the
+ * dequantized value.
+ */
+static float quantize(float value, float min, float max, uint16_t &out)
+{
+    auto range = max - min;
+
+    if (!(range > 0))
+    {
+        out = 0;
+        return std::fabs(value - min);
+    }
+
+    auto scaled = std::lround((value - min) / range * 65535.0f);
+    out = (uint16_t) std::max(0L, std::min(65535L, scaled));
+
+    return std::fabs(min + out / 65535.0f * range - value);
+}
+
+void write_compact_mesh(std::ostream &stream, const solid_object &object, compact_mesh_stats &stats)
+{
+    auto &mesh = *object.mesh;
+    std::vector<solid_mesh_vertex> vertices;
+
+    for (auto &vb : mesh.vertex_buffers)
+    {
+        auto data = vb.data.get();
+        auto decoded = vb.decode(*data);
+
+        vertices.insert(vertices.end(), decoded.begin(), decoded.end());
+        stats.source_bytes += data->size() * sizeof(float);
+    }
+
+    auto faces = mesh.faces.get();
+    stats.source_bytes += mesh.num_raw_indices() * sizeof(unsigned short);
+
+    std::string out;
+    put(out, kCompactMeshMagic);
+    put(out, (uint32_t) mesh.materials.size());
+    put_string(out, object.name);
+
+    std::vector<int> local_index(vertices.size(), -1);
+    auto face_idx = 0u;
+
+    for (auto &material : mesh.materials)
+    {
+        // Gather the vertices this material's triangles use, in first-use order.
+        std::vector<unsigned int> used, indices;
+        auto end = std::min<size_t>(face_idx + material.num_tris, faces->size());
+
+        for (auto i = face_idx; i < end; i++)
+        {
+            auto &face = (*faces)[i];
+            unsigned int corners[] = {face.face1, face.face2, face.face3};
+
+            if (corners[0] >= vertices.size() || corners[1] >= vertices.size() || corners[2] >= vertices.size())
+            {
+                continue;
+            }
+
+            for (auto corner : corners)
+            {
+                if (local_index[corner] == -1)
+                {
+                    local_index[corner] = (int) used.size();
+                    used.push_back(corner);
+                }
+
+                indices.push_back((unsigned int) local_index[corner]);
+            }
+        }
+
+        face_idx += material.num_tris;
+
+        // The material's bounds are stored in source axes; vertices have Y and
+        // Z swapped. Grow the box to cover any vertex outside it.
+        float position_min[] = {material.min_point.x, material.min_point.z, material.min_point.y};
+        float position_max[] = {material.max_point.x, material.max_point.z, material.max_point.y};
+        float uv_min[] = {0, 0}, uv_max[] = {0, 0};
+
+        for (auto i = 0u; i < used.size(); i++)
+        {
+            auto &vertex = vertices[used[i]];
+            float position[] = {vertex.x, vertex.y, vertex.z};
+            float uv[] = {vertex.u, vertex.v};
+
+            for (auto axis = 0; axis < 3; axis++)
+            {
+                position_min[axis] = std::min(position_min[axis], position[axis]);
+                position_max[axis] = std::max(position_max[axis], position[axis]);
+            }
+
+            for (auto axis = 0; axis < 2; axis++)
+            {
+                uv_min[axis] = i == 0 ? uv[axis] : std::min(uv_min[axis], uv[axis]);
+                uv_max[axis] = i == 0 ? uv[axis] : std::max(uv_max[axis], uv[axis]);
+            }
+        }
+
+        std::string positions, uvs, colors, index_data;
+
+        for (auto vertex_index : used)
+        {
+            auto &vertex = vertices[vertex_index];
+            float position[] = {vertex.x, vertex.y, vertex.z};
+            float uv[] = {vertex.u, vertex.v};
+            uint16_t q;
+
+            for (auto axis = 0; axis < 3; axis++)
+            {
+                stats.max_position_error = std::max(
+                        stats.max_position_error, quantize(position[axis], position_min[axis], position_max[axis], q));
+                put(positions, q);
+            }
+
+            for (auto axis = 0; axis < 2; axis++)
+            {
+                stats.max_uv_error = std::max(stats.max_uv_error, quantize(uv[axis], uv_min[axis], uv_max[axis], q));
+                put(uvs, q);
+            }
+
+            put(colors, (uint32_t) vertex.color);
+            local_index[vertex_index] = -1;
+        }
+
+        int64_t previous = 0;
+
+        for (auto index : indices)
+        {
+            auto delta = (int64_t) index - previous;
+            put_varint(index_data, (uint64_t) ((delta << 1) ^ (delta >> 63)));
+            previous = index;
+        }
+
+        put_string(out, material.name);
+        put(out, (uint32_t) material.texture_hash);
+        put(out, position_min);
+        put(out, position_max);
+        put(out, uv_min);
+        put(out, uv_max);
+        put(out, (uint32_t) used.size());
+        put(out, (uint32_t) indices.size());
+        put(out, (uint32_t) index_data.size());
+        out += positions;
+        out += uvs;
+        out += colors;
+        out += index_data;
+    }
+
+    stream.write(out.data(), out.size());
+    stats.compact_bytes += out.size();
+}
@@ -0,0 +1,28 @@
+#ifndef EXPLORER_COMPACT_MESH_HPP
+#define EXPLORER_COMPACT_MESH_HPP
+
+#include <ostream>
+#include "solid_list_stream.hpp"
+#include "compact_mesh_loader.hpp"
+
+/**
+ * Running totals over every mesh written with write_compact_mesh().
+ */
+struct compact_mesh_stats
+{
+    size_t source_bytes = 0;   // vertex and index payloads of the source meshes
+    size_t compact_bytes = 0;  // bytes written
+    float max_position_error = 0;
+    float max_uv_error = 0;
+};
+
+/**
+ * Writes object's mesh in the .xcm format described in compact_mesh_loader.hpp:
+ * one block per material with 16-bit quantized positions and UVs and
+ * delta-encoded indices. The quantization error actually incurred is
+ * measured and added to stats.
+ */
+void write_compact_mesh(std::ostream &stream, const solid_object &object, compact_mesh_stats &stats);
+
+
+#endif //EXPLORER_COMPACT_MESH_HPP
@@ -0,0 +1,219 @@
+#ifndef EXPLORER_COMPACT_MESH_LOADER_HPP
+#define EXPLORER_COMPACT_MESH_LOADER_HPP
+
+// Self-contained reader for .xcm files written by `Explorer --compact`.
+// Depends only on the standard library, so consumers can copy it as is.
+//
+// Layout (little-endian, unaligned):
+//
+//     char     magic[4]            "XCM1"
+//     u32      num_blocks
+//     u16      name_length, char name[name_length]
+//     num_blocks x {
+//         u16  name_length, char name[name_length]     material
+//         u32  texture_hash
+//         f32  position_min[3], position_max[3]
+//         f32  uv_min[2], uv_max[2]
+//         u32  num_vertices, num_indices, index_bytes
+//         u16  positions[num_vertices][3]     (v - min) / (max - min) * 65535
+//         u16  uvs[num_vertices][2]           likewise over the UV range
+//         u32  colors[num_vertices]
+//         u8   indices[index_bytes]           zigzag varint deltas
+//     }
+//
+// Indices are local to their block and form a triangle list.
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+const uint32_t kCompactMeshMagic = 0x314d4358; // "XCM1"
+
+struct compact_mesh_block
+{
+    std::string material;
+    uint32_t texture_hash;
+    float position_min[3], position_max[3];
+    float uv_min[2], uv_max[2];
+    std::vector<uint16_t> positions;
+    std::vector<uint16_t> uvs;
+    std::vector<uint32_t> colors;
+    std::vector<uint32_t> indices;
+
+    size_t num_vertices() const
+    {
+        return colors.size();
+    }
+
+    void position(size_t vertex, float out[3]) const
+    {
+        for (auto axis = 0; axis < 3; axis++)
+        {
+            out[axis] = position_min[axis] + positions[vertex * 3 + axis] / 65535.0f *
+                                             (position_max[axis] - position_min[axis]);
+        }
+    }
+
+    void uv(size_t vertex, float out[2]) const
+    {
+        for (auto axis = 0; axis < 2; axis++)
+        {
+            out[axis] = uv_min[axis] + uvs[vertex * 2 + axis] / 65535.0f * (uv_max[axis] - uv_min[axis]);
+        }
+    }
+};
+
+struct compact_mesh
+{
+    std::string name;
+    std::vector<compact_mesh_block> blocks;
+
+    /**
+     * @throws std::runtime_error if data isn't a complete .xcm file
+     */
+    static compact_mesh load(const void *data, size_t size)
+    {
+        reader in{(const unsigned char *) data, (const unsigned char *) data + size};
+        compact_mesh mesh;
+
+        if (in.get<uint32_t>() != kCompactMeshMagic)
+        {
+            throw std::runtime_error("Not a compact mesh");
+        }
+
+        // Counts are checked against the bytes left before anything is
+        // allocated, so a corrupt header can't request a huge allocation.
+        auto num_blocks = in.get<uint32_t>();
+        mesh.name = in.get_string();
+        in.take((size_t) num_blocks * kMinBlockBytes);
+        mesh.blocks.resize(num_blocks);
+
+        for (auto &block : mesh.blocks)
+        {
+            block.material = in.get_string();
+            block.texture_hash = in.get<uint32_t>();
+            in.get_array(block.position_min, 3);
+            in.get_array(block.position_max, 3);
+            in.get_array(block.uv_min, 2);
+            in.get_array(block.uv_max, 2);
+
+            auto num_vertices = in.get<uint32_t>();
+            auto num_indices = in.get<uint32_t>();
+            auto index_bytes = in.get<uint32_t>();
+
+            in.take((size_t) num_vertices * kVertexBytes + index_bytes);
+
+            if (num_indices > index_bytes)
+            {
+                throw std::runtime_error("Compact mesh index count mismatch");
+            }
+
+            block.positions.resize((size_t) num_vertices * 3);
+            block.uvs.resize((size_t) num_vertices * 2);
+            block.colors.resize(num_vertices);
+            in.get_array(block.positions.data(), block.positions.size());
+            in.get_array(block.uvs.data(), block.uvs.size());
+            in.get_array(block.colors.data(), block.colors.size());
+
+            auto end = in.take(index_bytes);
+            int64_t previous = 0;
+
+            block.indices.reserve(num_indices);
+
+            while (in.position < end)
+            {
+                auto zigzag = in.get_varint(end);
+                previous += (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+
+                if (previous < 0 || previous >= num_vertices)
+                {
+                    throw std::runtime_error("Compact mesh index out of range");
+                }
+
+                block.indices.push_back((uint32_t) previous);
+            }
+
+            if (block.indices.size() != num_indices)
+            {
+                throw std::runtime_error("Compact mesh index count mismatch");
+            }
+        }
+
+        return mesh;
+    }
+
+private:
+    // name length, texture hash, bounds and counts
+    static const size_t kMinBlockBytes = 2 + 4 + 10 * sizeof(float) + 3 * 4;
+    // quantized position and UV, and color
+    static const size_t kVertexBytes = 3 * 2 + 2 * 2 + 4;
+
+    struct reader
+    {
+        const unsigned char *position;
+        const unsigned char *end;
+
+        const unsigned char *take(size_t size)
+        {
+            if (size > (size_t) (end - position))
+            {
+                throw std::runtime_error("Truncated compact mesh");
+            }
+
+            return position + size;
+        }
+
+        template<typename T>
+        void get_array(T *out, size_t count)
+        {
+            auto next = take(count * sizeof(T));
+            memcpy(out, position, count * sizeof(T));
+            position = next;
+        }
+
+        template<typename T>
+        T get()
+        {
+            T value;
+            get_array(&value, 1);
+            return value;
+        }
+
+        std::string get_string()
+        {
+            auto length = get<uint16_t>();
+            auto next = take(length);
+            std::string result((const char *) position, length);
+            position = next;
+            return result;
+        }
+
+        uint64_t get_varint(const unsigned char *limit)
+        {
+            uint64_t value = 0;
+
+            for (auto shift = 0; shift < 64; shift += 7)
+            {
+                if (position >= limit)
+                {
+                    break;
+                }
+
+                auto byte = *position++;
+                value |= (uint64_t) (byte & 0x7F) << shift;
+
+                if ((byte & 0x80) == 0)
+                {
+                    return value;
+                }
+            }
+
+            throw std::runtime_error("Malformed compact mesh index");
+        }
+    };
+};
+
+
+#endif //EXPLORER_COMPACT_MESH_LOADER_HPP
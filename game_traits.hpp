@@ -0,0 +1,123 @@
+#ifndef EXPLORER_GAME_TRAITS_HPP
+#define EXPLORER_GAME_TRAITS_HPP
+
+#include "utils.hpp"
+
+/**
+ * Titles with known layouts. Every bundle is parsed as World, the only one
+ * so far.
+ */
+enum game_id
+{
+    GAME_WORLD
+};
+
+/**
+ * On-disk layouts of one title. The stream classes are instantiated once per
+ * specialization, so record sizes and field offsets are compile-time constants
+ * in the parsers. Other titles get a specialization and an enumerator once
+ * their layouts are known.
+ */
+template<game_id Game>
+struct game_traits;
+
+template<>
+struct game_traits<GAME_WORLD>
+{
+    struct PACK solid_list_info_struct
+    {
+        unsigned long long blank;
+        unsigned int unknown1;
+        unsigned int object_count;
+        char pipeline_path[0x38];
+        char class_type[0x20];
+        unsigned long long blank2;
+        unsigned int unknown_offset;
+    };
+
+    struct PACK solid_object_header_struct
+    {
+        unsigned int blank1;
+        unsigned int blank2;
+        unsigned int blank3;
+        unsigned int unknown1;
+        unsigned int hash;
+        unsigned int num_tris;
+        unsigned int unknown2;
+        unsigned int unknown3;
+        float bounds_min[4];
+        float bounds_max[4];
+        float transform[16]; // 4x4 matrix
+        unsigned int blank4[6];
+        float unknown4[2];
+    };
+
+    struct PACK mesh_descriptor_struct
+    {
+        unsigned long long unknown1;
+        unsigned int unknown2;
+        unsigned int flags;
+        unsigned int num_materials;
+        unsigned int blank1;
+        unsigned int num_vertex_buffers;
+        unsigned int blank2[3];
+        unsigned int num_tris;
+        unsigned int num_indices;
+        unsigned int blank3;
+    };
+
+    struct PACK mesh_material_struct
+    {
+        unsigned int flags;
+        unsigned int hash;
+        unsigned int unknown1, unknown2;
+        float min_point[3];
+        float max_point[3];
+        unsigned int unknown3;
+        unsigned char texture_assignments[4];
+        unsigned char unknown4[16];
+        unsigned int num_vertices;
+        unsigned int num_indices;
+        unsigned int num_tris;
+        unsigned int offset; // index buffer, not triangles
+        unsigned char unknown5[36];
+    };
+
+    struct PACK texture_pack_info_struct
+    {
+        unsigned int version;
+        char name[28];
+        char pipeline_path[64];
+        unsigned int hash;
+    };
+
+    struct PACK texture_info_struct
+    {
+        unsigned char blank[12];
+        unsigned int tex_hash, type_hash;
+        unsigned int unknown1;
+        unsigned int data_size;
+        unsigned int unknown2;
+        unsigned int width, height, mip_count;
+        unsigned int unknown3, unknown4;
+        unsigned char unknown5[24];
+        unsigned int unknown6;
+        unsigned int data_offset;
+        unsigned char unknown7[60];
+        unsigned char name_length;
+    };
+
+    struct PACK texture_format_struct
+    {
+        unsigned char unknown1[12];
+        unsigned int dds_type;
+        unsigned char unknown2[16];
+    };
+};
+
+static_assert(sizeof(game_traits<GAME_WORLD>::solid_object_header_struct) == 160);
+static_assert(sizeof(game_traits<GAME_WORLD>::mesh_material_struct) == 116);
+static_assert(sizeof(game_traits<GAME_WORLD>::texture_format_struct) == 32);
+
+
+#endif //EXPLORER_GAME_TRAITS_HPP
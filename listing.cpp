@@ -0,0 +1,127 @@
+#include "listing.hpp"
+#include "solid_list_stream.hpp"
+#include "texture_pack_stream.hpp"
+
+std::string texture_format_name(unsigned int dds_type)
+{
+    if (dds_type == 0x15)
+    {
+        return "A8R8G8B8";
+    }
+
+    std::string name;
+
+    for (auto i = 0; i < 4; i++)
+    {
+        auto c = (char) ((dds_type >> (i * 8)) & 0xFF);
+        name += isprint((unsigned char) c) ? c : '?';
+    }
+
+    return name;
+}
+
+static void write_text(std::ostream &stream, const std::vector<std::shared_ptr<base_data_resource>> &resources)
+{
+    for (auto &resource : resources)
+    {
+        if (auto tp = std::dynamic_pointer_cast<texture_pack>(resource))
+        {
+            write_line(stream, string_format("Texture Pack: %s [%s] %08X, %zu textures", tp->name.c_str(),
+                                             tp->pipeline_path.c_str(), tp->hash, tp->textures.size()));
+
+            for (auto &texture : tp->textures)
+            {
+                if (!texture) continue;
+
+                write_line(stream, string_format("\t%08X %-32s %4ux%-4u %2u mips %-8s %u bytes", texture->texture_hash,
+                                                 texture->name.c_str(), texture->width, texture->height,
+                                                 texture->mipmaps, texture_format_name(texture->dds_type).c_str(),
+                                                 texture->data_size));
+            }
+        } else if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+        {
+            write_line(stream, string_format("Solid List: %s [%s], %zu objects", slp->pipeline_path.c_str(),
+                                             slp->class_type.c_str(), slp->solid_objects.size()));
+
+            for (auto &object : slp->solid_objects)
+            {
+                write_line(stream, string_format("\t%08X %-32s at (%g, %g, %g) bounds (%g, %g, %g)-(%g, %g, %g)",
+                                                 object.hash, object.name.c_str(), object.posX, object.posY,
+                                                 object.posZ, object.min_point.x, object.min_point.y,
+                                                 object.min_point.z, object.max_point.x, object.max_point.y,
+                                                 object.max_point.z));
+            }
+        }
+    }
+}
+
+static void write_json(std::ostream &stream, const std::vector<std::shared_ptr<base_data_resource>> &resources)
+{
+    std::vector<std::string> texture_packs, solid_lists;
+
+    for (auto &resource : resources)
+    {
+        if (auto tp = std::dynamic_pointer_cast<texture_pack>(resource))
+        {
+            std::string textures;
+
+            for (auto &texture : tp->textures)
+            {
+                if (!texture) continue;
+
+                textures += string_format(
+                        R"(%s{"hash":"%08X","name":"%s","width":%u,"height":%u,"mipmaps":%u,"format":"%s","size":%u})",
+                        textures.empty() ? "" : ",", texture->texture_hash, json_escape(texture->name).c_str(),
+                        texture->width, texture->height, texture->mipmaps,
+                        json_escape(texture_format_name(texture->dds_type)).c_str(), texture->data_size);
+            }
+
+            texture_packs.push_back(string_format(R"({"name":"%s","pipeline_path":"%s","hash":"%08X","textures":[%s]})",
+                                                  json_escape(tp->name).c_str(),
+                                                  json_escape(tp->pipeline_path).c_str(), tp->hash,
+                                                  textures.c_str()));
+        } else if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+        {
+            std::string objects;
+
+            for (auto &object : slp->solid_objects)
+            {
+                objects += string_format(
+                        R"(%s{"hash":"%08X","name":"%s","position":[%g,%g,%g],"min":[%g,%g,%g],"max":[%g,%g,%g]})",
+                        objects.empty() ? "" : ",", object.hash, json_escape(object.name).c_str(), object.posX,
+                        object.posY, object.posZ, object.min_point.x, object.min_point.y, object.min_point.z,
+                        object.max_point.x, object.max_point.y, object.max_point.z);
+            }
+
+            solid_lists.push_back(string_format(R"({"pipeline_path":"%s","class_type":"%s","objects":[%s]})",
+                                                json_escape(slp->pipeline_path).c_str(),
+                                                json_escape(slp->class_type).c_str(), objects.c_str()));
+        }
+    }
+
+    auto join = [](const std::vector<std::string> &items)
+    {
+        std::string result;
+
+        for (auto &item : items)
+        {
+            result += (result.empty() ? "\n    " : ",\n    ") + item;
+        }
+
+        return result;
+    };
+
+    write_line(stream, string_format("{\n  \"texture_packs\": [%s\n  ],\n  \"solid_lists\": [%s\n  ]\n}",
+                                     join(texture_packs).c_str(), join(solid_lists).c_str()));
+}
+
+void write_listing(std::ostream &stream, const std::vector<std::shared_ptr<base_data_resource>> &resources, bool json)
+{
+    if (json)
+    {
+        write_json(stream, resources);
+    } else
+    {
+        write_text(stream, resources);
+    }
+}
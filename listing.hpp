@@ -0,0 +1,21 @@
+#ifndef EXPLORER_LISTING_HPP
+#define EXPLORER_LISTING_HPP
+
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "chunk_stream.hpp"
+
+/**
+ * @return FourCC as text ("DXT1", ...), or the pixel layout for uncompressed formats
+ */
+std::string texture_format_name(unsigned int dds_type);
+
+/**
+ * Writes an inventory of parsed texture packs and solid lists, either as
+ * indented text or as a single JSON document.
+ */
+void write_listing(std::ostream &stream, const std::vector<std::shared_ptr<base_data_resource>> &resources, bool json);
+
+
+#endif //EXPLORER_LISTING_HPP
@@ -1,38 +1,533 @@
 #include <iostream>
+#include <chrono>
+#include <future>
+#include <set>
 #include <boost/filesystem.hpp>
 #include "chunk_stream.hpp"
 #include "texture_pack_stream.hpp"
 #include "solid_list_stream.hpp"
+#include "manifest.hpp"
+#include "texture_index.hpp"
+#include "resource_server.hpp"
+#include "trace.hpp"
+#include "listing.hpp"
+#include "compact_mesh.hpp"
+#include "scene_export.hpp"
+#include "bundle_diff.hpp"
+#include "material_batching.hpp"
+#include "thread_pool.hpp"
+#include "mesh_stats.hpp"
+#include "output_archive.hpp"
+#include "baked_bundle.hpp"
+#include "object_selection.hpp"
+#include "bundle_watch.hpp"
+#include "chunk_store.hpp"
 
-void read_child_chunks(std::shared_ptr<chunk> chunk, std::shared_ptr<chunk_stream> stream)
+const unsigned int kSolidListChunk = 0x80134000;
+
+/**
+ * How long watch waits after a write for more writes to the same bundles.
+ */
+const int kWatchSettleMs = 50;
+
+struct extract_options
+{
+    bool force = false;
+    bool compact = false;
+    bool batch_materials = false;
+    bool batch_across_objects = false;
+    const name_dictionary *names = nullptr;
+    std::shared_ptr<resource_cache> cache;
+    std::string archive;
+    object_selection only;
+};
+
+/**
+ * Hash of the options that change the bytes of exported files. It is folded
+ * into every output's fingerprint, so outputs written with other options
+ * count as stale.
+ */
+static unsigned long long output_digest(const extract_options &options)
 {
-    auto tmpStream = stream->substream(chunk->offset, chunk->length);
+    bool modes[] = {options.compact, options.batch_materials, options.batch_across_objects};
+    auto digest = hash_bytes(modes, sizeof(modes));
 
-    while (tmpStream->data_remaining())
+    if (options.names != nullptr)
     {
-        auto tmpChunk = tmpStream->read_chunk();
+        digest = hash_bytes(&digest, sizeof(digest), options.names->digest());
+    }
 
-//        fprintf(stdout, "\t%08X [%d bytes] @ %08X\n", tmpChunk->type, tmpChunk->length, tmpChunk->offset);
+    // A batch over a whole list only holds the selected objects.
+    if (options.batch_across_objects)
+    {
+        digest = hash_bytes(&digest, sizeof(digest), options.only.digest());
+    }
 
-        if (tmpChunk->is_parent)
+    return digest;
+}
+
+/**
+ * @return the fingerprint of an output written from [offset, offset + length),
+ * whose bytes hash to content_hash, with options hashing to digest
+ */
+static output_fingerprint fingerprint_for(unsigned int offset, unsigned int length, unsigned long long content_hash,
+                                          unsigned long long digest)
+{
+    return output_fingerprint{offset, length, hash_bytes(&digest, sizeof(digest), content_hash), kExporterVersion};
+}
+
+/**
+ * Destination of extracted files: loose files in the output directory, or
+ * members of an archive.
+ */
+struct output_sink
+{
+    boost::filesystem::path directory;
+    archive_writer *archive = nullptr;
+
+    template<typename Writer>
+    void write(const std::string &name, unsigned int hash, Writer writer) const
+    {
+        if (archive != nullptr)
         {
-            read_child_chunks(tmpChunk, tmpStream);
+            std::ostringstream stream(std::ios::binary);
+            writer(stream);
+            archive->add(name, hash, stream.str());
+        } else
+        {
+            std::ofstream stream((directory / name).string(), std::ios::trunc | std::ios::binary);
+            writer(stream);
         }
+    }
+};
 
-        tmpStream->skip_chunk(tmpChunk);
+/**
+ * @return text with characters that aren't safe in file names replaced
+ */
+static std::string file_name_for(std::string text)
+{
+    for (auto &c : text)
+    {
+        if (!isalnum((unsigned char) c) && c != '_' && c != '-' && c != '.')
+        {
+            c = '_';
+        }
     }
+
+    return text;
 }
 
-int main(int argc, char **argv)
+static bool is_current(const extraction_manifest &manifest, const std::string &stem,
+                       std::initializer_list<const char *> extensions, const output_fingerprint &fingerprint)
 {
-    if (argc < 2)
+    for (auto extension : extensions)
     {
-        std::cerr << "Not enough arguments" << std::endl;
-        return 1;
+        if (!manifest.is_current(stem + extension, fingerprint))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void record(extraction_manifest &manifest, const std::string &stem,
+                   std::initializer_list<const char *> extensions, const output_fingerprint &fingerprint)
+{
+    for (auto extension : extensions)
+    {
+        manifest.record(stem + extension, fingerprint);
+    }
+}
+
+/**
+ * Fills stream.resources, from the bundle's bake when one is current.
+ *
+ * @return whether the bake was used
+ */
+static bool read_resources(chunk_stream &stream)
+{
+    auto &bundle_path = stream.source()->path();
+
+    if (auto baked = baked_bundle::open(baked_bundle::path_for(bundle_path), bundle_path))
+    {
+        stream.resources = baked->resources(stream.source(), stream.cache());
+        return true;
+    }
+
+    while (stream.data_remaining())
+    {
+        auto chunk = stream.read_chunk();
+
+        stream.process_chunk(chunk);
+        stream.skip_chunk(chunk);
+    }
+
+    return false;
+}
+
+static void write_batched(const batched_mesh &batched, const output_sink &sink, const std::string &stem,
+                          unsigned int hash, const name_dictionary *names)
+{
+    sink.write(stem + ".mtl", hash, [&](std::ostream &stream) { batched.write_mtl(stream, names); });
+    sink.write(stem + ".obj", hash, [&](std::ostream &stream) { batched.write_obj(stream, stem, stem + ".mtl"); });
+    sink.write(stem + ".batches", hash, [&](std::ostream &stream) { batched.write_remap(stream); });
+}
+
+/**
+ * Writes the outputs of cstream.resources that are out of date in the
+ * directory's manifest, or all of them with --force or --archive.
+ */
+static int export_resources(chunk_stream &cstream, const boost::filesystem::path &outputDirectory,
+                            const extract_options &options)
+{
+    auto selective = !options.only.empty();
+
+    // An archive is always written whole, so it bypasses the manifest.
+    std::unique_ptr<archive_writer> archive;
+    output_sink sink{outputDirectory};
+    auto force = options.force;
+
+    if (!options.archive.empty())
+    {
+        archive.reset(new archive_writer(options.archive));
+        sink.archive = archive.get();
+        force = true;
+    }
+
+    std::map<unsigned int, std::vector<std::string>> references;
+    std::set<unsigned int> resolved;
+    size_t selected_objects = 0;
+
+    if (selective)
+    {
+        references = texture_references(cstream.resources, options.only);
+    }
+
+    extraction_manifest manifest(outputDirectory.string());
+    auto digest = output_digest(options);
+    compact_mesh_stats compact_stats;
+    auto written = 0, skipped = 0;
+    size_t batched_materials = 0, batches = 0;
+
+    for (auto &resource : cstream.resources)
+    {
+        if (auto tp = std::dynamic_pointer_cast<texture_pack>(resource))
+        {
+            printf("Texture Pack: %s [%s]\n", tp->name.c_str(), tp->pipeline_path.c_str());
+
+            // Hash and write textures in parallel; the manifest is updated
+            // afterwards in table order.
+            struct texture_output
+            {
+                std::string name;
+                output_fingerprint fingerprint;
+                bool written;
+                bool excluded; // not used by the objects selected with --only
+                std::string contents; // rendered DDS, when writing to an archive
+            };
+
+            std::vector<texture_output> outputs(tp->textures.size());
+
+            parallel_for(tp->textures.size(), [&](size_t i)
+            {
+                auto &texture = tp->textures[i];
+                auto &output = outputs[i];
+
+                output.excluded = selective && references.count(texture->texture_hash) == 0;
+
+                if (output.excluded)
+                {
+                    return;
+                }
+
+                unsigned int fields[] = {texture->width, texture->height, texture->mipmaps, texture->dds_type};
+                auto payload = texture->data.get();
+
+                output.name = texture_file_name(texture->texture_hash, options.names);
+                output.fingerprint = fingerprint_for(
+                        texture->source_offset, texture->data_size,
+                        hash_bytes(payload->data(), payload->size(), hash_bytes(fields, sizeof(fields))), digest);
+                output.written = force || !manifest.is_current(output.name, output.fingerprint);
+
+                if (output.written && archive)
+                {
+                    std::ostringstream stream(std::ios::binary);
+                    texture->write_dds(stream, *payload);
+                    output.contents = stream.str();
+                } else if (output.written)
+                {
+                    texture->write_to_file((outputDirectory / output.name).string(), *payload);
+                }
+            });
+
+            for (auto i = 0u; i < outputs.size(); i++)
+            {
+                auto &output = outputs[i];
+
+                if (output.excluded)
+                {
+                    continue;
+                }
+
+                resolved.insert(tp->textures[i]->texture_hash);
+
+                if (output.written && archive)
+                {
+                    archive->add(output.name, tp->textures[i]->texture_hash, output.contents);
+                    output.contents = std::string();
+                    written++;
+                } else if (output.written)
+                {
+                    manifest.record(output.name, output.fingerprint);
+                    written++;
+                } else
+                {
+                    skipped++;
+                }
+            }
+        } else if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+        {
+            printf("Solid List: %s [%s]\n", slp->pipeline_path.c_str(), slp->class_type.c_str());
+
+            if (options.batch_across_objects)
+            {
+                if (selective)
+                {
+                    // Objects that weren't selected have no mesh and drop out of the batch.
+                    auto matched = std::count_if(slp->solid_objects.begin(), slp->solid_objects.end(),
+                                                 [&options](const solid_object &object)
+                                                 {
+                                                     return options.only.matches(object);
+                                                 });
+
+                    if (matched == 0)
+                    {
+                        continue;
+                    }
+
+                    selected_objects += matched;
+                }
+
+                auto name = file_name_for(slp->pipeline_path);
+                output_fingerprint fingerprint{0, 0, 0, kExporterVersion};
+
+                for (auto &slo : slp->solid_objects)
+                {
+                    fingerprint.offset = fingerprint.length == 0 ? slo.source_offset : fingerprint.offset;
+                    fingerprint.length += slo.source_length;
+                    fingerprint.content_hash = hash_bytes(&fingerprint.content_hash, sizeof(fingerprint.content_hash),
+                                                          cstream.hash_range(slo.source_offset, slo.source_length));
+                }
+
+                fingerprint = fingerprint_for(fingerprint.offset, fingerprint.length, fingerprint.content_hash, digest);
+
+                if (!force && is_current(manifest, name, {".obj", ".mtl", ".batches"}, fingerprint))
+                {
+                    skipped++;
+                    continue;
+                }
+
+                batched_mesh batched;
+                batched.add_list(*slp);
+                write_batched(batched, sink, name, 0, options.names);
+                record(manifest, name, {".obj", ".mtl", ".batches"}, fingerprint);
+                batched_materials += batched.remap.size();
+                batches += batched.batches.size();
+                written++;
+                continue;
+            }
+
+            for (auto& slo : slp->solid_objects) {
+                if (selective && !options.only.matches(slo))
+                {
+                    continue;
+                }
+
+                selected_objects++;
+
+                // Objects without a mesh (has_mesh == 0 in a bake) have nothing to write.
+                if (slo.mesh == nullptr)
+                {
+                    continue;
+                }
+
+                if (options.names != nullptr)
+                {
+                    // Materials without a name chunk are named after their texture.
+                    for (auto &material : slo.mesh->materials)
+                    {
+                        auto texture_name = options.names->find(material.texture_hash);
+
+                        if (texture_name != nullptr
+                            && material.name == string_format("unnamed-material-%08X", material.texture_hash))
+                        {
+                            material.name = texture_name;
+                        }
+                    }
+                }
+
+                if (options.compact)
+                {
+                    auto name = string_format("%s.xcm", slo.name.c_str());
+                    auto fingerprint = fingerprint_for(slo.source_offset, slo.source_length,
+                                                       cstream.hash_range(slo.source_offset, slo.source_length),
+                                                       digest);
+
+                    if (!force && manifest.is_current(name, fingerprint))
+                    {
+                        skipped++;
+                        continue;
+                    }
+
+                    sink.write(name, slo.hash, [&](std::ostream &stream)
+                    {
+                        write_compact_mesh(stream, slo, compact_stats);
+                    });
+                    manifest.record(name, fingerprint);
+                    written++;
+                    continue;
+                }
+
+                auto name = string_format("%s.obj", slo.name.c_str());
+                auto material_library_name = string_format("%s.mtl", slo.name.c_str());
+                auto fingerprint = fingerprint_for(slo.source_offset, slo.source_length,
+                                                   cstream.hash_range(slo.source_offset, slo.source_length), digest);
+
+                if (options.batch_materials)
+                {
+                    auto stem = slo.name;
+
+                    if (!force && is_current(manifest, stem, {".obj", ".mtl", ".batches"}, fingerprint))
+                    {
+                        skipped++;
+                        continue;
+                    }
+
+                    batched_mesh batched;
+                    batched.add_object(slo);
+                    write_batched(batched, sink, stem, slo.hash, options.names);
+                    record(manifest, stem, {".obj", ".mtl", ".batches"}, fingerprint);
+                    batched_materials += batched.remap.size();
+                    batches += batched.batches.size();
+                    written++;
+                    continue;
+                }
+
+                if (!force && manifest.is_current(name, fingerprint)
+                    && manifest.is_current(material_library_name, fingerprint))
+                {
+                    skipped++;
+                    continue;
+                }
+
+                TRACE_SCOPE_FMT("solid_object::write", "%s", slo.name.c_str());
+
+                sink.write(material_library_name, slo.hash, [&](std::ostream &stream)
+                {
+                    slo.write_mtl(stream, options.names);
+                });
+                sink.write(name, slo.hash, [&](std::ostream &stream)
+                {
+                    slo.write_obj(stream, material_library_name);
+                });
+                manifest.record(name, fingerprint);
+                manifest.record(material_library_name, fingerprint);
+                written++;
+            }
+        }
+    }
+
+    if (archive)
+    {
+        archive->close();
+        printf("archived %zu files -> %s\n", archive->size(), options.archive.c_str());
+    } else
+    {
+        manifest.save();
+    }
+
+    printf("exported %d resources, skipped %d unchanged\n", written, skipped);
+
+    if (selective)
+    {
+        printf("selected %zu objects referencing %zu textures\n", selected_objects, references.size());
+
+        for (auto &reference : references)
+        {
+            if (resolved.count(reference.first) == 0)
+            {
+                std::string users;
+
+                for (auto &object : reference.second)
+                {
+                    users += (users.empty() ? "" : ", ") + object;
+                }
+
+                printf("unresolved texture %08X (used by %s)\n", reference.first, users.c_str());
+            }
+        }
+
+        printf("read %llu of %zu bundle bytes\n", cstream.source()->bytes_read(), cstream.source()->size());
+    }
+
+    if (batches > 0)
+    {
+        printf("batched %zu materials into %zu draw groups\n", batched_materials, batches);
+    }
+
+    if (options.compact && compact_stats.source_bytes > 0)
+    {
+        printf("compact meshes: %zu -> %zu bytes (%.2fx), max position error %g, max uv error %g\n",
+               compact_stats.source_bytes, compact_stats.compact_bytes,
+               double(compact_stats.source_bytes) / compact_stats.compact_bytes, compact_stats.max_position_error,
+               compact_stats.max_uv_error);
+    }
+
+    if (auto &cache = options.cache)
+    {
+        printf("cache: %zu/%zu bytes resident, %zu hits, %zu misses, %zu evictions\n", cache->size(), cache->budget(),
+               cache->hits(), cache->misses(), cache->evictions());
     }
 
-    std::string inputFile(argv[1]);
+    return 0;
+}
+
+/**
+ * Opens a bundle with the cache and --only selection of options applied.
+ * map is passed on to byte_source::open().
+ */
+static std::shared_ptr<chunk_stream> open_for_extraction(const std::string &inputFile, const extract_options &options,
+                                                         bool map = true)
+{
+    std::shared_ptr<const byte_source> source;
+
+    {
+        TRACE_SCOPE_FMT("open", "%s", inputFile.c_str());
+        source = byte_source::open(inputFile, map);
+    }
+
+    auto cstream = std::make_shared<chunk_stream>(source);
+    cstream->set_cache(options.cache);
+
+    // With --only, just the selected objects' meshes and the textures they use are read.
+    if (!options.only.empty())
+    {
+        auto &only = options.only;
+        cstream->set_object_filter([&only](const solid_object &object)
+                                   {
+                                       return only.matches(object);
+                                   });
+    }
+
+    return cstream;
+}
+
+static int extract(const std::vector<std::string> &args, const extract_options &options)
+{
+    std::string inputFile(args[0]);
     boost::filesystem::path path(inputFile);
+    boost::filesystem::path outputDirectory(args.size() > 1 ? args[1] : ".");
 
     if (!boost::filesystem::is_regular_file(path))
     {
@@ -40,44 +535,716 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    std::ifstream stream(inputFile, std::ios::binary);
-    auto cstream = std::make_shared<chunk_stream>(stream);
+    if (options.archive.empty() && !boost::filesystem::is_directory(outputDirectory))
+    {
+        boost::filesystem::create_directories(outputDirectory);
+    }
+
+    auto cstream = open_for_extraction(inputFile, options);
 
     printf("stream length -> %lu bytes\n", cstream->get_length());
 
     clock_t begin = clock();
 
-    while (cstream->data_remaining())
+    auto baked = read_resources(*cstream);
+
+    clock_t end = clock();
+
+    printf("read%s in %f seconds\n", baked ? " from bake" : "", double(end - begin) / CLOCKS_PER_SEC);
+
+    return export_resources(*cstream, outputDirectory, options);
+}
+
+/**
+ * Re-extracts bundles whenever they are written. Each write is rescanned at
+ * the top level, and only the chunks whose bytes differ from the previous
+ * scan are parsed and exported. Returns once SIGINT or SIGTERM arrives and
+ * the current update has finished.
+ */
+static int watch(const std::vector<std::string> &args, const extract_options &options)
+{
+    if (args.size() < 2)
     {
-        auto chunk = cstream->read_chunk();
+        std::cerr << "Usage: Explorer watch <output directory> <bundle|directory>..." << std::endl;
+        return 1;
+    }
 
-        cstream->process_chunk(chunk);
-        cstream->skip_chunk(chunk);
+    if (!options.archive.empty())
+    {
+        std::cerr << "watch writes loose files and can't be combined with --archive" << std::endl;
+        return 1;
     }
 
-    clock_t end = clock();
+    boost::filesystem::path outputDirectory(args[0]);
+
+    if (!boost::filesystem::is_directory(outputDirectory))
+    {
+        boost::filesystem::create_directories(outputDirectory);
+    }
 
-    printf("read in %f seconds\n", double(end - begin) / CLOCKS_PER_SEC);
+    bundle_watcher watcher;
+    std::vector<std::string> bundles;
 
-    for (auto &resource : cstream->resources)
+    for (auto input = args.begin() + 1; input != args.end(); ++input)
     {
-        if (auto tp = std::dynamic_pointer_cast<texture_pack>(resource))
+        watcher.add(*input);
+
+        if (!boost::filesystem::is_directory(*input))
         {
-            printf("Texture Pack: %s [%s]\n", tp->name.c_str(), tp->pipeline_path.c_str());
+            bundles.push_back(*input);
+            continue;
+        }
 
-            for (auto &texture : tp->textures)
+        for (auto &entry : boost::filesystem::directory_iterator(*input))
+        {
+            if (boost::filesystem::is_regular_file(entry.path()) && is_bundle_path(entry.path().string()))
             {
-                texture->write_to_file(string_format("%08X.dds", texture->texture_hash));
+                bundles.push_back(entry.path().string());
             }
-        } else if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+        }
+    }
+
+    std::map<std::string, std::vector<chunk_fingerprint>> scans;
+
+    auto update = [&](const std::string &bundle)
+    {
+        auto begin = std::chrono::steady_clock::now();
+
+        try
         {
-            printf("Solid List: %s [%s]\n", slp->pipeline_path.c_str(), slp->class_type.c_str());
+            // Read, not mapped: the bundle may be truncated by its next write
+            // while it is being read, which would raise SIGBUS on a mapping.
+            auto cstream = open_for_extraction(bundle, options, false);
+            auto chunks = fingerprint_chunks(*cstream->source());
+            auto previous = scans.find(bundle);
+            auto changed = previous == scans.end() ? chunks : changed_chunks(previous->second, chunks);
 
-            for (auto& slo : slp->solid_objects) {
-                slo->write_to_file(string_format("%s.obj", slo->name.c_str()));
+            std::set<unsigned int> changed_offsets;
+
+            for (auto &fingerprint : changed)
+            {
+                changed_offsets.insert(fingerprint.offset);
             }
+
+            printf("%s: %zu of %zu chunks changed\n", bundle.c_str(), changed.size(), chunks.size());
+
+            for (auto &fingerprint : chunks)
+            {
+                // --only resolves textures through the selected objects, so
+                // every solid list is read even when only a texture changed.
+                if (changed_offsets.count(fingerprint.offset)
+                    || (!options.only.empty() && fingerprint.type == kSolidListChunk))
+                {
+                    auto chunk = std::make_shared<::chunk>(fingerprint.type, fingerprint.length, fingerprint.offset);
+
+                    cstream->seek(chunk->offset, 0);
+                    cstream->process_chunk(chunk);
+                }
+            }
+
+            if (!changed.empty())
+            {
+                export_resources(*cstream, outputDirectory, options);
+            }
+
+            scans[bundle] = std::move(chunks);
+        } catch (const std::exception &e)
+        {
+            // Usually a bundle that is still being written; its next write retries.
+            fprintf(stderr, "%s: %s\n", bundle.c_str(), e.what());
         }
+
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin);
+        printf("updated %s in %.1f ms\n", bundle.c_str(), elapsed.count());
+        fflush(stdout);
+    };
+
+    for (auto &bundle : bundles)
+    {
+        update(bundle);
+    }
+
+    printf("watching %zu bundles\n", bundles.size());
+    fflush(stdout);
+
+    while (!watcher.stop_requested())
+    {
+        for (auto &bundle : watcher.wait(kWatchSettleMs))
+        {
+            update(bundle);
+        }
+    }
+
+    printf("stopped watching\n");
+
+    return 0;
+}
+
+static int list(const std::vector<std::string> &args, bool json)
+{
+    if (args.empty())
+    {
+        std::cerr << "Usage: Explorer list <bundle> [--json]" << std::endl;
+        return 1;
+    }
+
+    if (!boost::filesystem::is_regular_file(args[0]))
+    {
+        std::cerr << "Not a file: " << args[0] << std::endl;
+        return 1;
     }
 
+    chunk_stream cstream(byte_source::open(args[0]));
+    cstream.set_headers_only(true);
+
+    read_resources(cstream);
+
+    write_listing(std::cout, cstream.resources, json);
+
     return 0;
-}
\ No newline at end of file
+}
+
+static int stats(const std::vector<std::string> &args)
+{
+    if (args.empty())
+    {
+        std::cerr << "Usage: Explorer stats <bundle>..." << std::endl;
+        return 1;
+    }
+
+    double parse_seconds = 0, analyze_seconds = 0;
+    size_t objects = 0, triangles = 0, degenerate = 0, out_of_range = 0, zero_area = 0;
+    size_t vertices = 0, bad_objects = 0, bad_materials = 0;
+    double area = 0;
+
+    for (auto &file : args)
+    {
+        if (!boost::filesystem::is_regular_file(file))
+        {
+            std::cerr << "Not a file: " << file << std::endl;
+            return 1;
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+
+        chunk_stream cstream(byte_source::open(file));
+
+        read_resources(cstream);
+
+        std::vector<const solid_object *> bundle_objects;
+
+        for (auto &resource : cstream.resources)
+        {
+            if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+            {
+                for (auto &object : slp->solid_objects)
+                {
+                    bundle_objects.push_back(&object);
+                }
+            }
+        }
+
+        auto parsed = std::chrono::steady_clock::now();
+
+        std::vector<object_stats> results(bundle_objects.size());
+
+        parallel_for(bundle_objects.size(), [&](size_t i)
+        {
+            results[i] = analyze_object(*bundle_objects[i]);
+        });
+
+        auto analyzed = std::chrono::steady_clock::now();
+
+        parse_seconds += std::chrono::duration<double>(parsed - begin).count();
+        analyze_seconds += std::chrono::duration<double>(analyzed - parsed).count();
+
+        for (auto &result : results)
+        {
+            auto &s = result.object;
+            auto mismatched = std::count_if(result.materials.begin(), result.materials.end(),
+                                            [](const geometry_stats &m) { return !m.bounds_match; });
+
+            if (!s.bounds_match || mismatched || s.degenerate || s.out_of_range)
+            {
+                printf("%s: %s%zu/%zu material bounds exceeded, %zu degenerate, %zu out of range\n",
+                       result.name.c_str(), s.bounds_match ? "" : "object bounds exceeded, ", (size_t) mismatched,
+                       result.materials.size(), s.degenerate, s.out_of_range);
+            }
+
+            objects++;
+            triangles += s.triangles;
+            degenerate += s.degenerate;
+            out_of_range += s.out_of_range;
+            zero_area += s.zero_area;
+            vertices += s.unique_vertices;
+            area += s.area;
+            bad_objects += !s.bounds_match;
+            bad_materials += mismatched;
+        }
+    }
+
+    printf("%zu objects, %zu triangles, %zu vertices used (%.2f triangles/vertex), total area %f\n",
+           objects, triangles, vertices, vertices ? double(triangles) / vertices : 0.0, area);
+    printf("%zu degenerate, %zu zero-area, %zu out of range, %zu object / %zu material bounds exceeded\n",
+           degenerate, zero_area, out_of_range, bad_objects, bad_materials);
+    printf("parsed in %f seconds, analyzed in %f seconds (%s)\n", parse_seconds, analyze_seconds,
+           mesh_stats_kernel());
+
+    return out_of_range || bad_objects || bad_materials ? 2 : 0;
+}
+
+static int bake(const std::vector<std::string> &args)
+{
+    if (args.empty())
+    {
+        std::cerr << "Usage: Explorer bake <bundle>..." << std::endl;
+        return 1;
+    }
+
+    for (auto &file : args)
+    {
+        if (!boost::filesystem::is_regular_file(file))
+        {
+            std::cerr << "Not a file: " << file << std::endl;
+            return 1;
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        chunk_stream cstream(byte_source::open(file));
+
+        while (cstream.data_remaining())
+        {
+            auto chunk = cstream.read_chunk();
+
+            cstream.process_chunk(chunk);
+            cstream.skip_chunk(chunk);
+        }
+
+        auto path = baked_bundle::path_for(file);
+        baked_bundle::write(path, file, cstream.resources);
+
+        auto parsed = std::chrono::steady_clock::now();
+        auto baked = baked_bundle::open(path, file);
+
+        if (!baked)
+        {
+            throw std::runtime_error(string_format("Cannot read back %s", path.c_str()));
+        }
+
+        auto resources = baked->resources(cstream.source(), nullptr);
+        auto loaded = std::chrono::steady_clock::now();
+
+        printf("%s: %zu resources, %llu bytes; parsed and baked in %f seconds, loads in %f seconds\n", path.c_str(),
+               resources.size(), (unsigned long long) boost::filesystem::file_size(path),
+               std::chrono::duration<double>(parsed - begin).count(),
+               std::chrono::duration<double>(loaded - parsed).count());
+    }
+
+    return 0;
+}
+
+static int read_archive(const std::vector<std::string> &args)
+{
+    if (args.empty())
+    {
+        std::cerr << "Usage: Explorer archive <archive> [<name|hash> [output directory]]" << std::endl;
+        return 1;
+    }
+
+    archive_reader archive(args[0]);
+
+    if (args.size() == 1)
+    {
+        for (auto &member : archive.members())
+        {
+            printf("%08X %12llu %s\n", member.hash, member.size, member.name.c_str());
+        }
+
+        return 0;
+    }
+
+    std::vector<const archive_member *> members;
+
+    if (auto member = archive.find(args[1]))
+    {
+        members.push_back(member);
+    } else
+    {
+        char *end;
+        auto hash = (unsigned int) std::strtoul(args[1].c_str(), &end, 16);
+
+        if (*end == 0 && !args[1].empty())
+        {
+            members = archive.find(hash);
+        }
+    }
+
+    if (members.empty())
+    {
+        std::cerr << "Not in archive: " << args[1] << std::endl;
+        return 1;
+    }
+
+    boost::filesystem::path outputDirectory(args.size() > 2 ? args[2] : ".");
+    boost::filesystem::create_directories(outputDirectory);
+
+    for (auto member : members)
+    {
+        auto contents = archive.read(*member);
+        auto path = outputDirectory / file_name_for(member->name);
+        std::ofstream stream(path.string(), std::ios::trunc | std::ios::binary);
+
+        stream.write(contents.data(), contents.size());
+        printf("%s (%llu bytes)\n", path.string().c_str(), member->size);
+    }
+
+    return 0;
+}
+
+static int ingest(const std::vector<std::string> &args)
+{
+    if (args.size() < 2)
+    {
+        std::cerr << "Usage: Explorer ingest <store directory> <bundle>..." << std::endl;
+        return 1;
+    }
+
+    chunk_store store(args[0]);
+    ingest_stats total;
+    auto begin = std::chrono::steady_clock::now();
+
+    for (auto bundle = args.begin() + 1; bundle != args.end(); ++bundle)
+    {
+        if (!boost::filesystem::is_regular_file(*bundle))
+        {
+            std::cerr << "Not a file: " << *bundle << std::endl;
+            return 1;
+        }
+
+        auto name = chunk_store::name_for(*bundle);
+        auto stats = store.ingest(*bundle, name);
+
+        printf("%s: %zu pieces, %zu new, %llu of %llu bytes stored, %llu inline\n", name.c_str(), stats.pieces,
+               stats.new_pieces, stats.new_bytes, stats.bytes, stats.inline_bytes);
+
+        total.pieces += stats.pieces;
+        total.new_pieces += stats.new_pieces;
+        total.bytes += stats.bytes;
+        total.new_bytes += stats.new_bytes;
+        total.inline_bytes += stats.inline_bytes;
+    }
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    printf("ingested %zu bundles (%llu bytes) in %f seconds; %llu new bytes stored (%.1f%% shared)\n",
+           args.size() - 1, total.bytes, elapsed, total.new_bytes,
+           total.bytes == 0 ? 0.0 : 100.0 * (1.0 - double(total.new_bytes + total.inline_bytes) / total.bytes));
+
+    return 0;
+}
+
+static int restore(const std::vector<std::string> &args)
+{
+    if (args.empty() || args.size() == 2)
+    {
+        std::cerr << "Usage: Explorer restore <store directory> [<bundle> <output file>]" << std::endl;
+        return 1;
+    }
+
+    chunk_store store(args[0]);
+
+    if (args.size() == 1)
+    {
+        for (auto &name : store.bundles())
+        {
+            printf("%s\n", name.c_str());
+        }
+
+        return 0;
+    }
+
+    store.restore(chunk_store::name_for(args[1]), args[2]);
+    printf("%s -> %s\n", args[1].c_str(), args[2].c_str());
+
+    return 0;
+}
+
+static int export_scene(const std::vector<std::string> &args, std::shared_ptr<resource_cache> cache)
+{
+    if (args.size() < 2)
+    {
+        std::cerr << "Usage: Explorer scene <output.glb> <bundle>..." << std::endl;
+        return 1;
+    }
+
+    scene_builder scene;
+
+    for (auto i = 1u; i < args.size(); i++)
+    {
+        if (!boost::filesystem::is_regular_file(args[i]))
+        {
+            std::cerr << "Not a file: " << args[i] << std::endl;
+            return 1;
+        }
+
+        chunk_stream cstream(byte_source::open(args[i]));
+        cstream.set_cache(cache);
+
+        read_resources(cstream);
+
+        for (auto &resource : cstream.resources)
+        {
+            if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+            {
+                scene.add(*slp);
+            }
+        }
+    }
+
+    scene.write_glb(args[0]);
+
+    printf("%zu nodes, %zu meshes -> %s\n", scene.num_nodes(), scene.num_meshes(), args[0].c_str());
+
+    return 0;
+}
+
+static int diff(const std::vector<std::string> &args)
+{
+    if (args.size() < 2)
+    {
+        std::cerr << "Usage: Explorer diff <old bundle> <new bundle>" << std::endl;
+        return 1;
+    }
+
+    for (auto &filename : args)
+    {
+        if (!boost::filesystem::is_regular_file(filename))
+        {
+            std::cerr << "Not a file: " << filename << std::endl;
+            return 1;
+        }
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+
+    // Each file is read once, on its own thread.
+    auto before = std::async(std::launch::async, digest_bundle, args[0]);
+    auto after = std::async(std::launch::async, digest_bundle, args[1]);
+
+    auto counts = write_bundle_diff(std::cout, before.get(), after.get());
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    printf("%zu added, %zu removed, %zu modified, %zu unchanged in %f seconds\n", counts.added, counts.removed,
+           counts.modified, counts.unchanged, elapsed);
+
+    return counts.added + counts.removed + counts.modified > 0 ? 2 : 0;
+}
+
+static int build_index(const std::vector<std::string> &args)
+{
+    if (args.size() < 2)
+    {
+        std::cerr << "Usage: Explorer index <directory> <index file>" << std::endl;
+        return 1;
+    }
+
+    clock_t begin = clock();
+    auto count = texture_index::build(args[0], args[1]);
+    clock_t end = clock();
+
+    printf("indexed %u textures in %f seconds\n", count, double(end - begin) / CLOCKS_PER_SEC);
+
+    return 0;
+}
+
+static int lookup_texture(const std::vector<std::string> &args)
+{
+    if (args.size() < 2)
+    {
+        std::cerr << "Usage: Explorer lookup <index file> <texture hash> [output file]" << std::endl;
+        return 1;
+    }
+
+    texture_index index(args[0]);
+    auto hash = (unsigned int) std::stoul(args[1], nullptr, 16);
+
+    auto begin = std::chrono::steady_clock::now();
+    auto entry = index.find(hash);
+
+    if (entry == nullptr)
+    {
+        std::cerr << "Texture not found: " << args[1] << std::endl;
+        return 1;
+    }
+
+    auto filename = args.size() > 2 ? args[2] : string_format("%08X.dds", hash);
+    index.extract(*entry, filename);
+    auto end = std::chrono::steady_clock::now();
+
+    printf("%08X: %s @ %08X [%u bytes] -> %s in %lld us\n", entry->texture_hash, index.file_name(*entry).c_str(),
+           entry->data_offset, entry->data_size, filename.c_str(),
+           (long long) std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count());
+
+    return 0;
+}
+
+static int serve(const std::vector<std::string> &args, std::shared_ptr<resource_cache> cache)
+{
+    if (args.size() < 2)
+    {
+        std::cerr << "Usage: Explorer serve <socket path> <bundle>..." << std::endl;
+        return 1;
+    }
+
+    resource_server server(args[0]);
+    server.set_cache(cache);
+
+    for (auto i = 1; i < args.size(); i++)
+    {
+        clock_t begin = clock();
+        server.load(args[i]);
+        clock_t end = clock();
+
+        printf("loaded %s in %f seconds\n", args[i].c_str(), double(end - begin) / CLOCKS_PER_SEC);
+    }
+
+    printf("listening on %s\n", args[0].c_str());
+    fflush(stdout);
+
+    server.run();
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> args;
+    extract_options options;
+    auto json = false;
+    std::unique_ptr<name_dictionary> names;
+    std::shared_ptr<resource_cache> cache;
+
+    for (auto i = 1; i < argc; i++)
+    {
+        std::string arg(argv[i]);
+
+        if (arg == "--force")
+        {
+            options.force = true;
+        } else if (arg == "--json")
+        {
+            json = true;
+        } else if (arg == "--compact")
+        {
+            options.compact = true;
+        } else if (arg == "--batch-materials")
+        {
+            options.batch_materials = true;
+        } else if (arg == "--batch-across-objects")
+        {
+            options.batch_across_objects = true;
+        } else if (arg == "--only" && i + 1 < argc)
+        {
+            options.only.add(argv[++i]);
+        } else if (arg == "--archive" && i + 1 < argc)
+        {
+            options.archive = argv[++i];
+        } else if (arg == "--cache-budget" && i + 1 < argc)
+        {
+            cache = std::make_shared<resource_cache>(std::stoull(argv[++i]) << 20);
+        } else if (arg == "--names" && i + 1 < argc)
+        {
+            names.reset(new name_dictionary);
+
+            auto begin = clock();
+            names->load(argv[++i]);
+
+            printf("loaded %zu names in %f seconds\n", names->size(), double(clock() - begin) / CLOCKS_PER_SEC);
+        } else if (arg == "--threads" && i + 1 < argc)
+        {
+            set_worker_count((unsigned int) std::stoul(argv[++i]));
+        } else if (arg == "--trace" && i + 1 < argc)
+        {
+            trace_begin_session(argv[++i]);
+        } else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.empty())
+    {
+        std::cerr << "Not enough arguments" << std::endl;
+        std::cerr << "Usage: Explorer <bundle> [output directory] [--force] [--compact] [--batch-materials]"
+                     " [--batch-across-objects] [--only <pattern>] [--archive <file>] [--names <dictionary>] [--cache-budget <MiB>] [--threads <n>]"
+                     " [--trace <file>]"
+                  << std::endl;
+        std::cerr << "       Explorer list <bundle> [--json]" << std::endl;
+        std::cerr << "       Explorer bake <bundle>..." << std::endl;
+        std::cerr << "       Explorer archive <archive> [<name|hash> [output directory]]" << std::endl;
+        std::cerr << "       Explorer stats <bundle>..." << std::endl;
+        std::cerr << "       Explorer scene <output.glb> <bundle>..." << std::endl;
+        std::cerr << "       Explorer diff <old bundle> <new bundle>" << std::endl;
+        std::cerr << "       Explorer index <directory> <index file>" << std::endl;
+        std::cerr << "       Explorer lookup <index file> <texture hash> [output file]" << std::endl;
+        std::cerr << "       Explorer serve <socket path> <bundle>... [--cache-budget <MiB>]" << std::endl;
+        std::cerr << "       Explorer ingest <store directory> <bundle>..." << std::endl;
+        std::cerr << "       Explorer restore <store directory> [<bundle> <output file>]" << std::endl;
+        std::cerr << "       Explorer watch <output directory> <bundle|directory>... [extract options]" << std::endl;
+        return 1;
+    }
+
+    auto command = args[0];
+    std::vector<std::string> command_args(args.begin() + 1, args.end());
+
+    int result;
+
+    if (command == "list")
+    {
+        result = list(command_args, json);
+    } else if (command == "bake")
+    {
+        result = bake(command_args);
+    } else if (command == "archive")
+    {
+        result = read_archive(command_args);
+    } else if (command == "stats")
+    {
+        result = stats(command_args);
+    } else if (command == "scene")
+    {
+        result = export_scene(command_args, cache);
+    } else if (command == "diff")
+    {
+        result = diff(command_args);
+    } else if (command == "index")
+    {
+        result = build_index(command_args);
+    } else if (command == "lookup")
+    {
+        result = lookup_texture(command_args);
+    } else if (command == "serve")
+    {
+        result = serve(command_args, cache);
+    } else if (command == "ingest")
+    {
+        result = ingest(command_args);
+    } else if (command == "restore")
+    {
+        result = restore(command_args);
+    } else if (command == "watch")
+    {
+        options.names = names.get();
+        options.cache = cache;
+        result = watch(command_args, options);
+    } else
+    {
+        options.names = names.get();
+        options.cache = cache;
+        result = extract(args, options);
+    }
+
+    trace_end_session();
+
+    return result;
+}
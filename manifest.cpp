@@ -0,0 +1,70 @@
+#include "manifest.hpp"
+#include "utils.hpp"
+#include <boost/filesystem.hpp>
+
+const char *extraction_manifest::kFileName = ".explorer-manifest";
+
+static const char *kManifestHeader = "# explorer manifest 1";
+
+extraction_manifest::extraction_manifest(std::string directory) : m_directory(directory)
+{
+    std::ifstream stream(boost::filesystem::path(directory).append(kFileName).string());
+    std::string line;
+
+    if (!std::getline(stream, line) || line != kManifestHeader)
+    {
+        // Missing or foreign manifest: treat every output as stale.
+        return;
+    }
+
+    // <version> <offset> <length> <content hash> <output name>
+    while (std::getline(stream, line))
+    {
+        output_fingerprint fingerprint{};
+        int name_pos = 0;
+
+        if (sscanf(line.c_str(), "%u %u %u %llx %n", &fingerprint.version, &fingerprint.offset, &fingerprint.length,
+                   &fingerprint.content_hash, &name_pos) != 4 || name_pos == 0)
+        {
+            continue;
+        }
+
+        m_entries[line.substr(name_pos)] = fingerprint;
+    }
+}
+
+bool extraction_manifest::is_current(const std::string &output, const output_fingerprint &fingerprint) const
+{
+    auto it = m_entries.find(output);
+
+    return it != m_entries.end()
+           && it->second == fingerprint
+           && boost::filesystem::is_regular_file(boost::filesystem::path(m_directory).append(output));
+}
+
+void extraction_manifest::record(const std::string &output, const output_fingerprint &fingerprint)
+{
+    m_entries[output] = fingerprint;
+}
+
+void extraction_manifest::save() const
+{
+    auto path = boost::filesystem::path(m_directory).append(kFileName).string();
+    auto temp_path = path + ".tmp";
+
+    {
+        simple_filewriter sfw(temp_path);
+
+        sfw.write_line(kManifestHeader);
+
+        for (auto &entry : m_entries)
+        {
+            auto &fingerprint = entry.second;
+
+            sfw.write_line(string_format("%u %u %u %016llx %s", fingerprint.version, fingerprint.offset,
+                                         fingerprint.length, fingerprint.content_hash, entry.first.c_str()));
+        }
+    }
+
+    boost::filesystem::rename(temp_path, path);
+}
@@ -0,0 +1,57 @@
+#ifndef EXPLORER_MANIFEST_HPP
+#define EXPLORER_MANIFEST_HPP
+
+#include <map>
+#include <string>
+
+/**
+ * Bump whenever exported files change for the same input, so that
+ * incremental runs rewrite everything produced by an older exporter.
+ */
+const unsigned int kExporterVersion = 1;
+
+/**
+ * Identifies the input an output file was produced from.
+ */
+struct output_fingerprint
+{
+    unsigned int offset;
+    unsigned int length;
+    unsigned long long content_hash;
+    unsigned int version;
+
+    bool operator==(const output_fingerprint &other) const
+    {
+        return offset == other.offset && length == other.length && content_hash == other.content_hash &&
+               version == other.version;
+    }
+};
+
+/**
+ * Record of every file written to an output directory and the source chunk it
+ * came from. Stored as a text file in the output directory so that later runs
+ * can skip outputs whose source is unchanged.
+ */
+class extraction_manifest
+{
+public:
+    static const char *kFileName;
+
+    explicit extraction_manifest(std::string directory);
+
+    /**
+     * @return true if output was written from an identical source and still exists on disk
+     */
+    bool is_current(const std::string &output, const output_fingerprint &fingerprint) const;
+
+    void record(const std::string &output, const output_fingerprint &fingerprint);
+
+    void save() const;
+
+private:
+    std::string m_directory;
+    std::map<std::string, output_fingerprint> m_entries;
+};
+
+
+#endif //EXPLORER_MANIFEST_HPP
@@ -0,0 +1,141 @@
+#include "material_batching.hpp"
+
+void batched_mesh::add_object(const solid_object &object)
+{
+    add(object, nullptr);
+}
+
+void batched_mesh::add_list(const solid_list &list)
+{
+    for (auto &object : list.solid_objects)
+    {
+        if (object.mesh == nullptr)
+        {
+            continue;
+        }
+
+        auto placement = object.placement();
+        add(object, &placement);
+    }
+}
+
+void batched_mesh::add(const solid_object &object, const matrix4 *placement)
+{
+    if (object.mesh == nullptr)
+    {
+        return;
+    }
+
+    auto base = (unsigned int) vertices.size();
+
+    for (auto &vb : object.mesh->vertex_buffers)
+    {
+        for (auto vertex : vb.decode(*vb.data.get()))
+        {
+            if (placement != nullptr)
+            {
+                // Vertices are Y/Z-swapped; the transform is in source axes.
+                auto &m = placement->m;
+                float x = vertex.x, y = vertex.z, z = vertex.y;
+
+                vertex.x = x * m[0] + y * m[4] + z * m[8] + m[12];
+                vertex.z = x * m[1] + y * m[5] + z * m[9] + m[13];
+                vertex.y = x * m[2] + y * m[6] + z * m[10] + m[14];
+            }
+
+            vertices.push_back(vertex);
+        }
+    }
+
+    auto num_vertices = (unsigned int) vertices.size() - base;
+    auto faces = object.mesh->faces.get();
+    auto face_idx = 0u;
+
+    for (auto i = 0u; i < object.mesh->materials.size(); i++)
+    {
+        auto &material = object.mesh->materials[i];
+        auto it = m_batch_by_texture.find(material.texture_hash);
+
+        if (it == m_batch_by_texture.end())
+        {
+            batches.push_back(material_batch{material.texture_hash, {}});
+            it = m_batch_by_texture.emplace(material.texture_hash, batches.size() - 1).first;
+        }
+
+        auto &batch = batches[it->second];
+        auto first_face = batch.indices.size() / 3;
+        auto end = std::min<size_t>(face_idx + material.num_tris, faces->size());
+
+        for (auto j = face_idx; j < end; j++)
+        {
+            auto &face = (*faces)[j];
+
+            if (face.face1 >= num_vertices || face.face2 >= num_vertices || face.face3 >= num_vertices)
+            {
+                continue;
+            }
+
+            batch.indices.insert(batch.indices.end(), {base + face.face1, base + face.face2, base + face.face3});
+        }
+
+        face_idx += material.num_tris;
+        remap.push_back(material_remap{object.name, i, material.name, it->second, first_face,
+                                       batch.indices.size() / 3 - first_face});
+    }
+}
+
+std::string batched_mesh::batch_name(const material_batch &batch)
+{
+    return string_format("batch-%08X", batch.texture_hash);
+}
+
+void batched_mesh::write_obj(std::ostream &stream, const std::string &name, const std::string &material_library) const
+{
+    write_line(stream, string_format("g %s", name.c_str()));
+    write_line(stream, string_format("mtllib %s", material_library.c_str()));
+
+    for (auto &vertex : vertices)
+    {
+        write_line(stream, string_format("v %f %f %f", vertex.x, vertex.y, vertex.z));
+        write_line(stream, string_format("vt %f %f", vertex.u, vertex.v));
+    }
+
+    for (auto &batch : batches)
+    {
+        write_line(stream, string_format("usemtl %s", batch_name(batch).c_str()));
+
+        for (auto i = 0u; i + 2 < batch.indices.size(); i += 3)
+        {
+            auto a = batch.indices[i] + 1, b = batch.indices[i + 1] + 1, c = batch.indices[i + 2] + 1;
+            write_line(stream, string_format("f %u/%u %u/%u %u/%u", a, a, b, b, c, c));
+        }
+    }
+}
+
+void batched_mesh::write_mtl(std::ostream &stream, const name_dictionary *names) const
+{
+    for (auto &batch : batches)
+    {
+        write_line(stream, string_format("newmtl %s", batch_name(batch).c_str()));
+        write_line(stream, "Ka 255 255 255");
+        write_line(stream, "Kd 255 255 255");
+        write_line(stream, "Ks 255 255 255");
+
+        auto texture_path = texture_file_name(batch.texture_hash, names);
+        write_line(stream, string_format("map_Ka %s", texture_path.c_str()));
+        write_line(stream, string_format("map_Kd %s", texture_path.c_str()));
+        write_line(stream, string_format("map_Ks %s", texture_path.c_str()));
+    }
+}
+
+void batched_mesh::write_remap(std::ostream &stream) const
+{
+    write_line(stream, "# object\tmaterial index\tmaterial\tbatch\tfirst face\tface count");
+
+    for (auto &entry : remap)
+    {
+        write_line(stream, string_format("%s\t%u\t%s\t%s\t%zu\t%zu", entry.object.c_str(), entry.material_index,
+                                         entry.material.c_str(), batch_name(batches[entry.batch]).c_str(),
+                                         entry.first_face, entry.face_count));
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef EXPLORER_MATERIAL_BATCHING_HPP
+#define EXPLORER_MATERIAL_BATCHING_HPP
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "solid_list_stream.hpp"
+
+/**
+ * Where one source material's triangles ended up.
+ */
+struct material_remap
+{
+    std::string object;
+    unsigned int material_index;
+    std::string material;
+    size_t batch;
+    size_t first_face, face_count; // triangle range within the batch
+};
+
+/**
+ * All triangles that share one texture assignment.
+ */
+struct material_batch
+{
+    unsigned int texture_hash;
+    std::vector<unsigned int> indices; // triangle list into batched_mesh::vertices
+};
+
+/**
+ * Geometry regrouped so that every texture is drawn by exactly one batch.
+ */
+class batched_mesh
+{
+public:
+    std::vector<solid_mesh_vertex> vertices;
+    std::vector<material_batch> batches;
+    std::vector<material_remap> remap;
+
+    /**
+     * Merges object's materials by texture hash. Vertices stay in object space.
+     */
+    void add_object(const solid_object &object);
+
+    /**
+     * Merges the materials of every object in list. Each object's placement is
+     * applied to its vertices, because the batches mix objects.
+     */
+    void add_list(const solid_list &list);
+
+    static std::string batch_name(const material_batch &batch);
+
+    void write_obj(std::ostream &stream, const std::string &name, const std::string &material_library) const;
+
+    void write_mtl(std::ostream &stream, const name_dictionary *names = nullptr) const;
+
+    /**
+     * One tab-separated line per source material: object, material index and
+     * name, batch, and the material's face range inside the batch.
+     */
+    void write_remap(std::ostream &stream) const;
+
+private:
+    std::map<unsigned int, size_t> m_batch_by_texture;
+
+    void add(const solid_object &object, const matrix4 *placement);
+};
+
+
+#endif //EXPLORER_MATERIAL_BATCHING_HPP
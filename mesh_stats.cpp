@@ -0,0 +1,293 @@
+#include "mesh_stats.hpp"
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EXPLORER_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+bool aabb::contains(const aabb &other, float tolerance) const
+{
+    for (auto axis = 0; axis < 3; axis++)
+    {
+        auto slack = tolerance * std::max(1.0f, max[axis] - min[axis]);
+
+        if (other.min[axis] < min[axis] - slack || other.max[axis] > max[axis] + slack)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Structure-of-arrays copy of the vertices and triangles being analyzed.
+ */
+struct soa_geometry
+{
+    std::vector<float> x, y, z;
+    std::vector<unsigned int> a, b, c;
+};
+
+static void bounds_scalar(const soa_geometry &g, aabb &box)
+{
+    const std::vector<float> *axes[] = {&g.x, &g.y, &g.z};
+
+    for (auto axis = 0; axis < 3; axis++)
+    {
+        for (auto value : *axes[axis])
+        {
+            box.min[axis] = std::min(box.min[axis], value);
+            box.max[axis] = std::max(box.max[axis], value);
+        }
+    }
+}
+
+static void indices_scalar(const soa_geometry &g, size_t begin, unsigned int num_vertices, size_t &degenerate,
+                           size_t &out_of_range)
+{
+    for (auto i = begin; i < g.a.size(); i++)
+    {
+        degenerate += g.a[i] == g.b[i] || g.b[i] == g.c[i] || g.a[i] == g.c[i];
+        out_of_range += g.a[i] >= num_vertices || g.b[i] >= num_vertices || g.c[i] >= num_vertices;
+    }
+}
+
+#ifdef EXPLORER_HAVE_AVX2
+
+__attribute__((target("avx2")))
+static void bounds_avx2(const soa_geometry &g, aabb &box)
+{
+    const std::vector<float> *axes[] = {&g.x, &g.y, &g.z};
+
+    for (auto axis = 0; axis < 3; axis++)
+    {
+        auto &values = *axes[axis];
+        auto lo = _mm256_set1_ps(box.min[axis]);
+        auto hi = _mm256_set1_ps(box.max[axis]);
+        size_t i = 0;
+
+        for (; i + 8 <= values.size(); i += 8)
+        {
+            auto v = _mm256_loadu_ps(&values[i]);
+            lo = _mm256_min_ps(lo, v);
+            hi = _mm256_max_ps(hi, v);
+        }
+
+        float lanes_lo[8], lanes_hi[8];
+        _mm256_storeu_ps(lanes_lo, lo);
+        _mm256_storeu_ps(lanes_hi, hi);
+
+        for (auto l = 0; l < 8; l++)
+        {
+            box.min[axis] = std::min(box.min[axis], lanes_lo[l]);
+            box.max[axis] = std::max(box.max[axis], lanes_hi[l]);
+        }
+
+        for (; i < values.size(); i++)
+        {
+            box.min[axis] = std::min(box.min[axis], values[i]);
+            box.max[axis] = std::max(box.max[axis], values[i]);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void indices_avx2(const soa_geometry &g, unsigned int num_vertices, size_t &degenerate, size_t &out_of_range)
+{
+    // Unsigned a >= n is tested as max(a, n) == a.
+    auto limit = _mm256_set1_epi32((int) num_vertices);
+    size_t i = 0;
+
+    for (; i + 8 <= g.a.size(); i += 8)
+    {
+        auto a = _mm256_loadu_si256((const __m256i *) &g.a[i]);
+        auto b = _mm256_loadu_si256((const __m256i *) &g.b[i]);
+        auto c = _mm256_loadu_si256((const __m256i *) &g.c[i]);
+
+        auto repeated = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi32(a, b), _mm256_cmpeq_epi32(b, c)),
+                                        _mm256_cmpeq_epi32(a, c));
+        auto beyond = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_max_epu32(a, limit), a),
+                                _mm256_cmpeq_epi32(_mm256_max_epu32(b, limit), b)),
+                _mm256_cmpeq_epi32(_mm256_max_epu32(c, limit), c));
+
+        degenerate += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(repeated)));
+        out_of_range += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(beyond)));
+    }
+
+    indices_scalar(g, i, num_vertices, degenerate, out_of_range);
+}
+
+static bool use_avx2()
+{
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#else
+
+static bool use_avx2()
+{
+    return false;
+}
+
+#endif
+
+const char *mesh_stats_kernel()
+{
+    return use_avx2() ? "avx2" : "scalar";
+}
+
+/**
+ * Fills stats from the triangles g.a/b/c and the vertices they use.
+ */
+static void analyze(const std::vector<solid_mesh_vertex> &vertices, soa_geometry &g, geometry_stats &stats)
+{
+    auto num_vertices = (unsigned int) vertices.size();
+
+    stats.triangles = g.a.size();
+
+#ifdef EXPLORER_HAVE_AVX2
+    if (use_avx2())
+    {
+        indices_avx2(g, num_vertices, stats.degenerate, stats.out_of_range);
+    } else
+#endif
+    {
+        indices_scalar(g, 0, num_vertices, stats.degenerate, stats.out_of_range);
+    }
+
+    // Gather the used vertices once, in SoA form, for the bounds reduction.
+    std::vector<bool> used(vertices.size(), false);
+
+    g.x.reserve(vertices.size());
+    g.y.reserve(vertices.size());
+    g.z.reserve(vertices.size());
+
+    for (auto *indices : {&g.a, &g.b, &g.c})
+    {
+        for (auto index : *indices)
+        {
+            if (index < num_vertices && !used[index])
+            {
+                used[index] = true;
+                g.x.push_back(vertices[index].x);
+                g.y.push_back(vertices[index].y);
+                g.z.push_back(vertices[index].z);
+            }
+        }
+    }
+
+    stats.unique_vertices = g.x.size();
+
+    for (auto axis = 0; axis < 3; axis++)
+    {
+        stats.bounds.min[axis] = std::numeric_limits<float>::infinity();
+        stats.bounds.max[axis] = -std::numeric_limits<float>::infinity();
+    }
+
+#ifdef EXPLORER_HAVE_AVX2
+    if (use_avx2())
+    {
+        bounds_avx2(g, stats.bounds);
+    } else
+#endif
+    {
+        bounds_scalar(g, stats.bounds);
+    }
+
+    for (size_t i = 0; i < g.a.size(); i++)
+    {
+        if (g.a[i] >= num_vertices || g.b[i] >= num_vertices || g.c[i] >= num_vertices)
+        {
+            continue;
+        }
+
+        auto &p = vertices[g.a[i]], &q = vertices[g.b[i]], &r = vertices[g.c[i]];
+        float u[] = {q.x - p.x, q.y - p.y, q.z - p.z};
+        float v[] = {r.x - p.x, r.y - p.y, r.z - p.z};
+        float n[] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2], u[0] * v[1] - u[1] * v[0]};
+        auto area = 0.5 * std::sqrt((double) n[0] * n[0] + (double) n[1] * n[1] + (double) n[2] * n[2]);
+
+        stats.area += area;
+        stats.zero_area += area == 0;
+    }
+}
+
+/**
+ * Header bounds are stored in source axes; swap Y and Z to compare with
+ * decoded vertices.
+ */
+static aabb header_bounds(const vector3 &min_point, const vector3 &max_point)
+{
+    return aabb{{min_point.x, min_point.z, min_point.y}, {max_point.x, max_point.z, max_point.y}};
+}
+
+object_stats analyze_object(const solid_object &object)
+{
+    const float kTolerance = 1e-4f;
+
+    object_stats result;
+    result.name = object.name;
+
+    if (!object.mesh)
+    {
+        return result;
+    }
+
+    std::vector<solid_mesh_vertex> vertices;
+
+    for (auto &vb : object.mesh->vertex_buffers)
+    {
+        auto decoded = vb.decode(*vb.data.get());
+        vertices.insert(vertices.end(), decoded.begin(), decoded.end());
+    }
+
+    auto faces = object.mesh->faces.get();
+    soa_geometry all;
+    all.a.reserve(faces->size());
+    all.b.reserve(faces->size());
+    all.c.reserve(faces->size());
+    auto face_idx = 0u;
+
+    for (auto &material : object.mesh->materials)
+    {
+        soa_geometry g;
+        auto end = std::min<size_t>(face_idx + material.num_tris, faces->size());
+
+        g.a.reserve(end - std::min<size_t>(face_idx, end));
+        g.b.reserve(g.a.capacity());
+        g.c.reserve(g.a.capacity());
+
+        for (auto i = face_idx; i < end; i++)
+        {
+            auto &face = (*faces)[i];
+            g.a.push_back(face.face1);
+            g.b.push_back(face.face2);
+            g.c.push_back(face.face3);
+        }
+
+        face_idx += material.num_tris;
+
+        all.a.insert(all.a.end(), g.a.begin(), g.a.end());
+        all.b.insert(all.b.end(), g.b.begin(), g.b.end());
+        all.c.insert(all.c.end(), g.c.begin(), g.c.end());
+
+        geometry_stats stats;
+        analyze(vertices, g, stats);
+        stats.bounds_match = stats.bounds.empty()
+                             || header_bounds(material.min_point, material.max_point).contains(stats.bounds,
+                                                                                                 kTolerance);
+        result.materials.push_back(stats);
+    }
+
+    analyze(vertices, all, result.object);
+    result.object.bounds_match = result.object.bounds.empty()
+                                 || header_bounds(object.min_point, object.max_point).contains(result.object.bounds,
+                                                                                               kTolerance);
+
+    return result;
+}
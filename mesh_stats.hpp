@@ -0,0 +1,56 @@
+#ifndef EXPLORER_MESH_STATS_HPP
+#define EXPLORER_MESH_STATS_HPP
+
+#include <string>
+#include <vector>
+#include "solid_list_stream.hpp"
+
+struct aabb
+{
+    float min[3];
+    float max[3];
+
+    bool empty() const
+    {
+        return min[0] > max[0];
+    }
+
+    /**
+     * @return whether other lies inside this box, give or take tolerance
+     */
+    bool contains(const aabb &other, float tolerance) const;
+};
+
+struct geometry_stats
+{
+    aabb bounds;              // of the vertices the triangles use, in exported (Y/Z-swapped) axes
+    bool bounds_match;        // bounds lie within the header's min_point/max_point
+    size_t triangles = 0;
+    size_t degenerate = 0;    // triangles that repeat an index
+    size_t out_of_range = 0;  // triangles with an index past the vertex buffers
+    size_t unique_vertices = 0;
+    double area = 0;
+    size_t zero_area = 0;
+};
+
+struct object_stats
+{
+    std::string name;
+    geometry_stats object;
+    std::vector<geometry_stats> materials;
+};
+
+/**
+ * Recomputes an object's bounds and triangle statistics from its decoded
+ * vertex and face arrays. Bounds and index checks run as AVX2 reductions
+ * when the CPU supports them, with a scalar fallback.
+ */
+object_stats analyze_object(const solid_object &object);
+
+/**
+ * @return "avx2" or "scalar", whichever analyze_object() uses on this CPU
+ */
+const char *mesh_stats_kernel();
+
+
+#endif //EXPLORER_MESH_STATS_HPP
@@ -0,0 +1,359 @@
+#include "name_dictionary.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <numeric>
+#include <boost/filesystem.hpp>
+
+const unsigned int kNameTableMagic = 0x31504d4e; // "NMP1"
+const unsigned int kDirectSlot = 0x80000000;     // seed flag: the bucket's only key sits in the low bits' slot
+const unsigned int kMaxSeed = 1u << 24;
+
+struct name_table_header
+{
+    unsigned int magic;
+    unsigned int num_slots;
+    unsigned int num_buckets;
+    unsigned int names_size;
+    unsigned long long dictionary_size;
+    long long dictionary_time;
+};
+
+static unsigned int mix(unsigned int key, unsigned int seed)
+{
+    auto h = key ^ (seed * 0x9E3779B9u);
+
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+
+    return h;
+}
+
+void bin_hash_batch(const std::vector<std::string> &names, std::vector<unsigned int> &hashes)
+{
+    const size_t kLanes = 8;
+
+    std::vector<size_t> order(names.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&names](size_t a, size_t b)
+    {
+        return names[a].size() < names[b].size();
+    });
+
+    hashes.resize(names.size());
+
+    for (size_t base = 0; base < order.size(); base += kLanes)
+    {
+        auto lanes = std::min(kLanes, order.size() - base);
+        const unsigned char *text[kLanes];
+        unsigned int length[kLanes];
+        unsigned int hash[kLanes];
+        unsigned int max_length = 0;
+
+        for (size_t l = 0; l < kLanes; l++)
+        {
+            auto &name = names[order[base + std::min(l, lanes - 1)]];
+
+            text[l] = (const unsigned char *) name.data();
+            length[l] = l < lanes ? (unsigned int) name.size() : 0;
+            hash[l] = 0xFFFFFFFFu;
+            max_length = std::max(max_length, length[l]);
+        }
+
+        for (unsigned int i = 0; i < max_length; i++)
+        {
+            unsigned int c[kLanes], active[kLanes];
+
+            for (size_t l = 0; l < kLanes; l++)
+            {
+                active[l] = i < length[l] ? 0xFFFFFFFFu : 0;
+                c[l] = text[l][std::min(i, length[l] > 0 ? length[l] - 1 : 0)];
+            }
+
+            for (size_t l = 0; l < kLanes; l++)
+            {
+                hash[l] = ((hash[l] * 33 + c[l]) & active[l]) | (hash[l] & ~active[l]);
+            }
+        }
+
+        for (size_t l = 0; l < lanes; l++)
+        {
+            hashes[order[base + l]] = hash[l];
+        }
+    }
+}
+
+void name_dictionary::load(const std::string &path)
+{
+    if (!boost::filesystem::is_regular_file(path))
+    {
+        throw std::runtime_error(string_format("Can't open name dictionary %s", path.c_str()));
+    }
+
+    auto dictionary_size = (unsigned long long) boost::filesystem::file_size(path);
+    auto dictionary_time = (long long) boost::filesystem::last_write_time(path);
+    auto cache_path = path + ".mph";
+
+    if (read_cache(cache_path, dictionary_size, dictionary_time))
+    {
+        return;
+    }
+
+    std::ifstream stream(path, std::ios::binary);
+    std::vector<std::string> names;
+    std::string line;
+
+    while (std::getline(stream, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        if (!line.empty())
+        {
+            names.push_back(line);
+        }
+    }
+
+    build(names);
+    write_cache(cache_path, dictionary_size, dictionary_time);
+}
+
+std::string texture_file_name(unsigned int texture_hash, const name_dictionary *names)
+{
+    auto name = names != nullptr ? names->find(texture_hash) : nullptr;
+
+    if (name == nullptr || *name == '\0')
+    {
+        return string_format("%08X.dds", texture_hash);
+    }
+
+    std::string file_name(name);
+
+    for (auto &c : file_name)
+    {
+        if (!isalnum((unsigned char) c) && c != '_' && c != '-' && c != '.')
+        {
+            c = '_';
+        }
+    }
+
+    return file_name + ".dds";
+}
+
+const char *name_dictionary::find(unsigned int hash) const
+{
+    if (m_slots.empty())
+    {
+        return nullptr;
+    }
+
+    auto seed = m_seeds[mix(hash, 0) % m_seeds.size()];
+    auto index = (seed & kDirectSlot) ? seed & ~kDirectSlot : mix(hash, seed) % m_slots.size();
+    auto &entry = m_slots[index];
+
+    return entry.hash == hash ? &m_names[entry.name_offset] : nullptr;
+}
+
+unsigned long long name_dictionary::digest() const
+{
+    return hash_bytes(m_names.data(), m_names.size(), hash_bytes(m_slots.data(), m_slots.size() * sizeof(slot)));
+}
+
+void name_dictionary::build(const std::vector<std::string> &names)
+{
+    std::vector<unsigned int> hashes;
+    bin_hash_batch(names, hashes);
+
+    // First name wins when two names share a hash.
+    std::vector<std::pair<unsigned int, unsigned int>> keys; // hash, name index
+
+    for (auto i = 0u; i < names.size(); i++)
+    {
+        keys.emplace_back(hashes[i], i);
+    }
+
+    std::stable_sort(keys.begin(), keys.end(), [](const std::pair<unsigned int, unsigned int> &a,
+                                                  const std::pair<unsigned int, unsigned int> &b)
+    {
+        return a.first < b.first;
+    });
+    keys.erase(std::unique(keys.begin(), keys.end(), [](const std::pair<unsigned int, unsigned int> &a,
+                                                        const std::pair<unsigned int, unsigned int> &b)
+    {
+        return a.first == b.first;
+    }), keys.end());
+
+    auto num_slots = (unsigned int) keys.size();
+    auto num_buckets = num_slots / 4 + 1;
+
+    m_seeds.assign(num_buckets, 0);
+    m_slots.assign(num_slots, slot{0, 0});
+    m_names.clear();
+
+    std::vector<std::vector<unsigned int>> buckets(num_buckets); // indices into keys
+
+    for (auto i = 0u; i < keys.size(); i++)
+    {
+        buckets[mix(keys[i].first, 0) % num_buckets].push_back(i);
+    }
+
+    std::vector<unsigned int> bucket_order(num_buckets);
+    std::iota(bucket_order.begin(), bucket_order.end(), 0);
+    std::stable_sort(bucket_order.begin(), bucket_order.end(), [&buckets](unsigned int a, unsigned int b)
+    {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<bool> taken(num_slots, false);
+    std::vector<unsigned int> candidate;
+    auto next_free = 0u;
+
+    auto place = [this, &keys, &names](unsigned int index, unsigned int key)
+    {
+        m_slots[index] = slot{keys[key].first, (unsigned int) m_names.size()};
+
+        auto &name = names[keys[key].second];
+        m_names.insert(m_names.end(), name.begin(), name.end());
+        m_names.push_back('\0');
+    };
+
+    for (auto b : bucket_order)
+    {
+        auto &bucket = buckets[b];
+
+        if (bucket.empty())
+        {
+            break;
+        }
+
+        if (bucket.size() == 1)
+        {
+            // Singletons go straight into the next free slot.
+            while (taken[next_free]) next_free++;
+
+            taken[next_free] = true;
+            m_seeds[b] = kDirectSlot | next_free;
+            place(next_free, bucket[0]);
+            continue;
+        }
+
+        auto seed = 1u;
+
+        for (; seed < kMaxSeed; seed++)
+        {
+            candidate.clear();
+
+            for (auto key : bucket)
+            {
+                auto index = mix(keys[key].first, seed) % num_slots;
+
+                if (taken[index] || std::find(candidate.begin(), candidate.end(), index) != candidate.end())
+                {
+                    break;
+                }
+
+                candidate.push_back(index);
+            }
+
+            if (candidate.size() == bucket.size())
+            {
+                break;
+            }
+        }
+
+        if (seed == kMaxSeed)
+        {
+            throw std::runtime_error(string_format("Can't place a bucket of %zu names", bucket.size()));
+        }
+
+        m_seeds[b] = seed;
+
+        for (auto i = 0u; i < bucket.size(); i++)
+        {
+            taken[candidate[i]] = true;
+            place(candidate[i], bucket[i]);
+        }
+    }
+}
+
+bool name_dictionary::read_cache(const std::string &path, unsigned long long dictionary_size,
+                                 long long dictionary_time)
+{
+    std::ifstream stream(path, std::ios::binary);
+    name_table_header header{};
+
+    if (!stream.read((char *) &header, sizeof(header))
+        || header.magic != kNameTableMagic
+        || header.dictionary_size != dictionary_size
+        || header.dictionary_time != dictionary_time
+        || header.num_buckets == 0
+        || header.num_slots == 0)
+    {
+        return false;
+    }
+
+    m_seeds.resize(header.num_buckets);
+    m_slots.resize(header.num_slots);
+    m_names.resize(header.names_size);
+
+    stream.read((char *) m_seeds.data(), m_seeds.size() * sizeof(unsigned int));
+    stream.read((char *) m_slots.data(), m_slots.size() * sizeof(slot));
+    stream.read(m_names.data(), m_names.size());
+
+    // find() indexes m_slots with direct seeds and m_names with slot offsets
+    // unchecked, so a damaged table is rebuilt rather than trusted.
+    auto valid = stream && (m_names.empty() || m_names.back() == '\0');
+
+    for (auto i = 0u; valid && i < m_seeds.size(); i++)
+    {
+        valid = !(m_seeds[i] & kDirectSlot) || (m_seeds[i] & ~kDirectSlot) < m_slots.size();
+    }
+
+    for (auto i = 0u; valid && i < m_slots.size(); i++)
+    {
+        valid = m_slots[i].name_offset < m_names.size();
+    }
+
+    if (!valid)
+    {
+        m_seeds.clear();
+        m_slots.clear();
+        m_names.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void name_dictionary::write_cache(const std::string &path, unsigned long long dictionary_size,
+                                  long long dictionary_time) const
+{
+    name_table_header header{
+            kNameTableMagic, (unsigned int) m_slots.size(), (unsigned int) m_seeds.size(),
+            (unsigned int) m_names.size(), dictionary_size, dictionary_time
+    };
+    auto temp_path = path + ".tmp";
+
+    {
+        std::ofstream stream(temp_path, std::ios::trunc | std::ios::binary);
+
+        stream.write((const char *) &header, sizeof(header));
+        stream.write((const char *) m_seeds.data(), m_seeds.size() * sizeof(unsigned int));
+        stream.write((const char *) m_slots.data(), m_slots.size() * sizeof(slot));
+        stream.write(m_names.data(), m_names.size());
+
+    }
+
+    // The cache only saves time; failing to write it isn't an error.
+    boost::system::error_code error;
+    boost::filesystem::rename(temp_path, path, error);
+
+    if (error)
+    {
+        boost::filesystem::remove(temp_path, error);
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef EXPLORER_NAME_DICTIONARY_HPP
+#define EXPLORER_NAME_DICTIONARY_HPP
+
+#include <string>
+#include <vector>
+
+/**
+ * The game's string hash for asset names: h = h * 33 + c, starting from
+ * 0xFFFFFFFF.
+ */
+inline unsigned int bin_hash(const char *name, size_t length)
+{
+    auto hash = 0xFFFFFFFFu;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = hash * 33 + (unsigned char) name[i];
+    }
+
+    return hash;
+}
+
+/**
+ * bin_hash() of count names, eight at a time. Each lane keeps its own
+ * hash, and lanes that run out of characters stop changing, so the inner
+ * loop is branch-free and vectorizes. Names are visited in length order so
+ * that lanes finish together.
+ */
+void bin_hash_batch(const std::vector<std::string> &names, std::vector<unsigned int> &hashes);
+
+/**
+ * Resolves bin hashes back to names from a dictionary of known asset names,
+ * one per line.
+ *
+ * Lookups use a minimal perfect hash (hash-and-displace): every name is
+ * given its own slot, and a lookup costs two mixes and one comparison.
+ * The built table is cached next to the dictionary as <dictionary>.mph.
+ * The cache is rebuilt when the dictionary's size or modification time
+ * changes.
+ */
+class name_dictionary
+{
+public:
+    /**
+     * Loads the cached table for path, or builds and caches it.
+     *
+     * @throws std::runtime_error if the dictionary can't be read
+     */
+    void load(const std::string &path);
+
+    /**
+     * @return the name hashing to hash, or null if the dictionary has none
+     */
+    const char *find(unsigned int hash) const;
+
+    size_t size() const
+    {
+        return m_slots.size();
+    }
+
+    /**
+     * @return hash of every hash-to-name mapping, for telling outputs written
+     * with a different dictionary apart
+     */
+    unsigned long long digest() const;
+
+private:
+    struct slot
+    {
+        unsigned int hash;
+        unsigned int name_offset;
+    };
+
+    std::vector<unsigned int> m_seeds;
+    std::vector<slot> m_slots;
+    std::vector<char> m_names;
+
+    void build(const std::vector<std::string> &names);
+
+    bool read_cache(const std::string &path, unsigned long long dictionary_size, long long dictionary_time);
+
+    void write_cache(const std::string &path, unsigned long long dictionary_size, long long dictionary_time) const;
+};
+
+/**
+ * @return "<name>.dds" if names resolves texture_hash, with characters that
+ * aren't safe in file names replaced, or "%08X.dds" otherwise
+ */
+std::string texture_file_name(unsigned int texture_hash, const name_dictionary *names);
+
+
+#endif //EXPLORER_NAME_DICTIONARY_HPP
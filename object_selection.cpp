@@ -0,0 +1,78 @@
+#include "object_selection.hpp"
+#include <algorithm>
+#include <fnmatch.h>
+#include "solid_list_stream.hpp"
+
+unsigned long long object_selection::digest() const
+{
+    auto digest = 0ull;
+
+    for (auto &pattern : m_patterns)
+    {
+        digest = hash_bytes(pattern.c_str(), pattern.size() + 1, digest);
+    }
+
+    return digest;
+}
+
+bool object_selection::matches(const solid_object &object) const
+{
+    auto hash = string_format("%08X", object.hash);
+
+    for (auto &pattern : m_patterns)
+    {
+        if (fnmatch(pattern.c_str(), object.name.c_str(), FNM_CASEFOLD) == 0
+            || fnmatch(pattern.c_str(), hash.c_str(), FNM_CASEFOLD) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::map<unsigned int, std::vector<std::string>>
+texture_references(const std::vector<std::shared_ptr<base_data_resource>> &resources,
+                   const object_selection &selection)
+{
+    std::map<unsigned int, std::vector<std::string>> references;
+
+    auto add = [&references](unsigned int texture_hash, const std::string &object_name)
+    {
+        auto &objects = references[texture_hash];
+
+        if (std::find(objects.begin(), objects.end(), object_name) == objects.end())
+        {
+            objects.push_back(object_name);
+        }
+    };
+
+    for (auto &resource : resources)
+    {
+        if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+        {
+            for (auto &object : slp->solid_objects)
+            {
+                if (!selection.matches(object))
+                {
+                    continue;
+                }
+
+                for (auto texture_hash : object.texture_hashes)
+                {
+                    add(texture_hash, object.name);
+                }
+
+                if (object.mesh)
+                {
+                    for (auto &material : object.mesh->materials)
+                    {
+                        add(material.texture_hash, object.name);
+                    }
+                }
+            }
+        }
+    }
+
+    return references;
+}
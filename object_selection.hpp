@@ -0,0 +1,50 @@
+#ifndef EXPLORER_OBJECT_SELECTION_HPP
+#define EXPLORER_OBJECT_SELECTION_HPP
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "chunk_stream.hpp"
+
+class solid_object;
+
+/**
+ * Set of solid objects picked by name or hash patterns. Patterns use shell
+ * wildcards (*, ?, [...]) and match case-insensitively against the object's
+ * name and against its hash written as eight hex digits.
+ */
+class object_selection
+{
+public:
+    void add(const std::string &pattern)
+    {
+        m_patterns.push_back(pattern);
+    }
+
+    bool empty() const
+    {
+        return m_patterns.empty();
+    }
+
+    bool matches(const solid_object &object) const;
+
+    /**
+     * @return hash of the patterns, in the order they were added
+     */
+    unsigned long long digest() const;
+
+private:
+    std::vector<std::string> m_patterns;
+};
+
+/**
+ * Texture hashes referenced by the selected objects, by their materials and
+ * texture tables, with the names of the objects that reference each one.
+ */
+std::map<unsigned int, std::vector<std::string>>
+texture_references(const std::vector<std::shared_ptr<base_data_resource>> &resources,
+                   const object_selection &selection);
+
+
+#endif //EXPLORER_OBJECT_SELECTION_HPP
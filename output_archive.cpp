@@ -0,0 +1,346 @@
+#include "output_archive.hpp"
+#include <cstring>
+#include "utils.hpp"
+
+const char *archive_writer::kIndexName = ".explorer-index";
+
+static const unsigned int kBlockSize = 512;
+static const char kFooterMagic[] = "EXPLIDX1 ";
+static const size_t kFooterSize = sizeof(kFooterMagic) - 1 + 16 + 1; // "EXPLIDX1 <16 hex digits>\n"
+
+struct ustar_header
+{
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char checksum[8];
+    char type;
+    char link_name[100];
+    char magic[6];
+    char version[2];
+    char user_name[32];
+    char group_name[32];
+    char device_major[8];
+    char device_minor[8];
+    char prefix[155];
+    char padding[12];
+};
+
+static_assert(sizeof(ustar_header) == kBlockSize, "ustar headers are one block");
+
+static unsigned long long padded(unsigned long long size)
+{
+    return (size + kBlockSize - 1) / kBlockSize * kBlockSize;
+}
+
+archive_writer::archive_writer(const std::string &path) : m_path(path), m_offset(0), m_closed(false)
+{
+    m_stream.open(path, std::ios::trunc | std::ios::binary);
+
+    if (!m_stream)
+    {
+        throw std::runtime_error(string_format("Cannot create archive %s", path.c_str()));
+    }
+}
+
+archive_writer::~archive_writer()
+{
+    try
+    {
+        close();
+    } catch (const std::exception &)
+    {
+    }
+}
+
+void archive_writer::write_header(const std::string &name, unsigned long long size, char type)
+{
+    if (size >= 077777777777ull)
+    {
+        throw std::runtime_error(string_format("%s is too large for a ustar archive", name.c_str()));
+    }
+
+    ustar_header header{};
+
+    strncpy(header.name, name.c_str(), sizeof(header.name));
+    snprintf(header.mode, sizeof(header.mode), "%07o", 0644);
+    snprintf(header.uid, sizeof(header.uid), "%07o", 0);
+    snprintf(header.gid, sizeof(header.gid), "%07o", 0);
+    snprintf(header.size, sizeof(header.size), "%011llo", size);
+    snprintf(header.mtime, sizeof(header.mtime), "%011o", 0);
+    header.type = type;
+    memcpy(header.magic, "ustar", 6);
+    memcpy(header.version, "00", 2);
+
+    memset(header.checksum, ' ', sizeof(header.checksum));
+
+    auto checksum = 0u;
+
+    for (auto i = 0u; i < sizeof(header); i++)
+    {
+        checksum += ((const unsigned char *) &header)[i];
+    }
+
+    snprintf(header.checksum, sizeof(header.checksum), "%06o", checksum);
+
+    m_stream.write((const char *) &header, sizeof(header));
+    m_offset += sizeof(header);
+}
+
+unsigned long long archive_writer::write_member(const std::string &name, const char *data, unsigned long long size, char type)
+{
+    if (name.size() > sizeof(ustar_header::name))
+    {
+        // Longer names go in a pax extended header ahead of the member.
+        auto record = " path=" + name + "\n";
+        auto length = record.size() + 1;
+
+        while (std::to_string(length).size() + record.size() != length)
+        {
+            length++;
+        }
+
+        record = std::to_string(length) + record;
+        write_header("PaxHeader/" + name.substr(0, 80), record.size(), 'x');
+        m_stream.write(record.data(), record.size());
+        m_offset += record.size();
+
+        static const char zeros[kBlockSize] = {};
+        auto padding = padded(m_offset) - m_offset;
+        m_stream.write(zeros, padding);
+        m_offset += padding;
+    }
+
+    write_header(name, size, type);
+
+    auto data_offset = m_offset;
+    m_stream.write(data, size);
+    m_offset += size;
+
+    static const char zeros[kBlockSize] = {};
+    auto padding = padded(m_offset) - m_offset;
+    m_stream.write(zeros, padding);
+    m_offset += padding;
+
+    return data_offset;
+}
+
+void archive_writer::add(const std::string &name, unsigned int hash, const std::string &contents)
+{
+    if (m_closed)
+    {
+        throw std::runtime_error(string_format("Archive %s is already closed", m_path.c_str()));
+    }
+
+    auto data_offset = write_member(name, contents.data(), contents.size(), '0');
+    m_members.push_back(archive_member{name, hash, data_offset, contents.size()});
+
+    if (!m_stream)
+    {
+        throw std::runtime_error(string_format("Cannot write to archive %s", m_path.c_str()));
+    }
+}
+
+void archive_writer::close()
+{
+    if (m_closed)
+    {
+        return;
+    }
+
+    m_closed = true;
+
+    std::string index;
+
+    for (auto &member : m_members)
+    {
+        index += string_format("%016llX %llu %08X %s\n", member.data_offset, member.size, member.hash,
+                               member.name.c_str());
+    }
+
+    // Pad with blank lines so that the footer ends the index's last block.
+    index.append(padded(index.size() + kFooterSize) - index.size() - kFooterSize, '\n');
+    // The index name is short, so its data follows a single header block.
+    index += string_format("%s%016llX\n", kFooterMagic, m_offset + kBlockSize);
+
+    write_member(kIndexName, index.data(), index.size(), '0');
+
+    static const char zeros[kBlockSize * 2] = {};
+    m_stream.write(zeros, sizeof(zeros));
+    m_stream.close();
+
+    if (!m_stream)
+    {
+        throw std::runtime_error(string_format("Cannot write to archive %s", m_path.c_str()));
+    }
+}
+
+archive_reader::archive_reader(const std::string &path) : m_source(byte_source::open(path))
+{
+    if (!read_index())
+    {
+        scan();
+    }
+}
+
+bool archive_reader::read_index()
+{
+    auto size = m_source->size();
+
+    if (size < kBlockSize * 3 + kFooterSize)
+    {
+        return false;
+    }
+
+    auto index_end = size - kBlockSize * 2;
+    auto footer = *m_source->read_vector_at<char>(index_end - kFooterSize, kFooterSize);
+
+    if (memcmp(footer.data(), kFooterMagic, sizeof(kFooterMagic) - 1) != 0)
+    {
+        return false;
+    }
+
+    auto index_offset = std::strtoull(std::string(footer.begin() + sizeof(kFooterMagic) - 1, footer.end()).c_str(),
+                                      nullptr, 16);
+
+    if (index_offset >= index_end)
+    {
+        throw std::runtime_error(string_format("Corrupt archive index in %s", m_source->path().c_str()));
+    }
+
+    auto index = *m_source->read_vector_at<char>(index_offset, index_end - kFooterSize - index_offset);
+    std::string text(index.begin(), index.end());
+    size_t line_start = 0;
+
+    while (line_start < text.size())
+    {
+        auto line_end = text.find('\n', line_start);
+        line_end = line_end == std::string::npos ? text.size() : line_end;
+
+        if (line_end > line_start)
+        {
+            auto line = text.substr(line_start, line_end - line_start);
+            archive_member member{};
+            char *cursor;
+
+            member.data_offset = std::strtoull(line.c_str(), &cursor, 16);
+            member.size = std::strtoull(cursor, &cursor, 10);
+            member.hash = (unsigned int) std::strtoul(cursor, &cursor, 16);
+
+            if (*cursor != ' ' || member.data_offset + member.size > index_offset)
+            {
+                throw std::runtime_error(string_format("Corrupt archive index in %s", m_source->path().c_str()));
+            }
+
+            member.name = cursor + 1;
+            m_members.push_back(member);
+        }
+
+        line_start = line_end + 1;
+    }
+
+    return true;
+}
+
+void archive_reader::scan()
+{
+    unsigned long long offset = 0;
+    std::string long_name;
+
+    while (offset + kBlockSize <= m_source->size())
+    {
+        ustar_header header;
+        m_source->read_at(&header, sizeof(header), offset);
+
+        if (header.name[0] == 0)
+        {
+            break;
+        }
+
+        auto size = std::strtoull(std::string(header.size, strnlen(header.size, sizeof(header.size))).c_str(),
+                                  nullptr, 8);
+        auto data_offset = offset + kBlockSize;
+
+        if (data_offset + size > m_source->size())
+        {
+            throw std::runtime_error(string_format("Truncated archive %s", m_source->path().c_str()));
+        }
+
+        if (header.type == 'x')
+        {
+            auto records = *m_source->read_vector_at<char>(data_offset, size);
+            std::string text(records.begin(), records.end());
+            auto path = text.find(" path=");
+
+            if (path != std::string::npos)
+            {
+                auto end = text.find('\n', path);
+                long_name = text.substr(path + 6, end == std::string::npos ? std::string::npos : end - path - 6);
+            }
+        } else if (header.type == '0' || header.type == 0)
+        {
+            std::string name;
+
+            if (!long_name.empty())
+            {
+                name = long_name;
+            } else
+            {
+                name.assign(header.name, strnlen(header.name, sizeof(header.name)));
+
+                if (memcmp(header.magic, "ustar", 5) == 0 && header.prefix[0])
+                {
+                    name = std::string(header.prefix, strnlen(header.prefix, sizeof(header.prefix))) + "/" + name;
+                }
+            }
+
+            if (name != archive_writer::kIndexName)
+            {
+                m_members.push_back(archive_member{name, 0, data_offset, size});
+            }
+
+            long_name.clear();
+        } else
+        {
+            long_name.clear();
+        }
+
+        offset = data_offset + padded(size);
+    }
+}
+
+const archive_member *archive_reader::find(const std::string &name) const
+{
+    for (auto &member : m_members)
+    {
+        if (member.name == name)
+        {
+            return &member;
+        }
+    }
+
+    return nullptr;
+}
+
+std::vector<const archive_member *> archive_reader::find(unsigned int hash) const
+{
+    std::vector<const archive_member *> found;
+
+    for (auto &member : m_members)
+    {
+        if (member.hash == hash)
+        {
+            found.push_back(&member);
+        }
+    }
+
+    return found;
+}
+
+std::vector<char> archive_reader::read(const archive_member &member) const
+{
+    return *m_source->read_vector_at<char>(member.data_offset, member.size);
+}
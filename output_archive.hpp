@@ -0,0 +1,102 @@
+#ifndef EXPLORER_OUTPUT_ARCHIVE_HPP
+#define EXPLORER_OUTPUT_ARCHIVE_HPP
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "byte_source.hpp"
+
+struct archive_member
+{
+    std::string name;
+    unsigned int hash;              // texture or object hash, 0 if none
+    unsigned long long data_offset; // absolute file offset of the contents
+    unsigned long long size;
+};
+
+/**
+ * Writes extracted files as members of one uncompressed ustar archive,
+ * appending sequentially.
+ *
+ * close() adds a last member, kIndexName, that lists every member as
+ * "<data offset> <size> <hash> <name>" lines. It is padded so that it ends on
+ * a block boundary, and its last bytes are a footer holding the index's own
+ * data offset. This puts the footer just before the two zero blocks at the
+ * end of the archive. archive_reader can find it with one read, and tar still
+ * sees an ordinary file.
+ */
+class archive_writer
+{
+public:
+    static const char *kIndexName;
+
+    explicit archive_writer(const std::string &path);
+
+    ~archive_writer();
+
+    void add(const std::string &name, unsigned int hash, const std::string &contents);
+
+    /**
+     * Writes the index and the end-of-archive blocks.
+     */
+    void close();
+
+    size_t size() const
+    {
+        return m_members.size();
+    }
+
+private:
+    std::string m_path;
+    std::ofstream m_stream;
+    unsigned long long m_offset;
+    std::vector<archive_member> m_members;
+    bool m_closed;
+
+    void write_header(const std::string &name, unsigned long long size, char type);
+
+    /**
+     * @return file offset of the member's contents
+     */
+    unsigned long long write_member(const std::string &name, const char *data, unsigned long long size, char type);
+};
+
+/**
+ * Reads members back out of an archive. Archives written by archive_writer
+ * are located through their index; any other ustar archive is scanned
+ * header by header.
+ */
+class archive_reader
+{
+public:
+    explicit archive_reader(const std::string &path);
+
+    const std::vector<archive_member> &members() const
+    {
+        return m_members;
+    }
+
+    /**
+     * @return the member with this name, or nullptr
+     */
+    const archive_member *find(const std::string &name) const;
+
+    /**
+     * @return every member with this hash
+     */
+    std::vector<const archive_member *> find(unsigned int hash) const;
+
+    std::vector<char> read(const archive_member &member) const;
+
+private:
+    std::shared_ptr<const byte_source> m_source;
+    std::vector<archive_member> m_members;
+
+    bool read_index();
+
+    void scan();
+};
+
+
+#endif //EXPLORER_OUTPUT_ARCHIVE_HPP
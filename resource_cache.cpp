@@ -0,0 +1,48 @@
+#include "resource_cache.hpp"
+
+std::shared_ptr<const void> resource_cache::find(const cache_key &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_index.find(key);
+
+    if (it == m_index.end())
+    {
+        m_misses++;
+        return nullptr;
+    }
+
+    m_hits++;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+
+    return it->second->payload;
+}
+
+void resource_cache::insert(const cache_key &key, std::shared_ptr<const void> payload, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_index.find(key);
+
+    if (it != m_index.end())
+    {
+        m_size -= it->second->bytes;
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+
+    m_entries.push_front(entry{key, payload, bytes});
+    m_index[key] = m_entries.begin();
+    m_size += bytes;
+
+    // Evict from the cold end, but always keep the entry just inserted.
+    while (m_budget != 0 && m_size > m_budget && m_entries.size() > 1)
+    {
+        auto &victim = m_entries.back();
+
+        m_size -= victim.bytes;
+        m_index.erase(victim.key);
+        m_entries.pop_back();
+        m_evictions++;
+    }
+}
@@ -0,0 +1,168 @@
+#ifndef EXPLORER_RESOURCE_CACHE_HPP
+#define EXPLORER_RESOURCE_CACHE_HPP
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct cache_key
+{
+    unsigned long long source; // byte_source::id()
+    unsigned int kind;
+    unsigned long long offset;
+
+    bool operator==(const cache_key &other) const
+    {
+        return source == other.source && kind == other.kind && offset == other.offset;
+    }
+};
+
+struct cache_key_hash
+{
+    size_t operator()(const cache_key &key) const
+    {
+        return (size_t) ((key.source * 0xC2B2AE3D27D4EB4FULL) ^ (key.offset + ((unsigned long long) key.kind << 40))
+                         * 0x9E3779B97F4A7C15ULL);
+    }
+};
+
+/**
+ * Least-recently-used store of decoded payloads with a byte budget.
+ *
+ * Entries are shared_ptrs, so evicting one only drops the cache's reference;
+ * callers holding it keep the payload alive until they are done with it.
+ */
+class resource_cache
+{
+public:
+    /**
+     * @param budget maximum resident bytes, or 0 for no limit
+     */
+    explicit resource_cache(size_t budget) : m_budget(budget), m_size(0), m_hits(0), m_misses(0), m_evictions(0)
+    {}
+
+    std::shared_ptr<const void> find(const cache_key &key);
+
+    void insert(const cache_key &key, std::shared_ptr<const void> payload, size_t bytes);
+
+    size_t budget() const
+    {
+        return m_budget;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    size_t hits() const
+    {
+        return m_hits;
+    }
+
+    size_t misses() const
+    {
+        return m_misses;
+    }
+
+    size_t evictions() const
+    {
+        return m_evictions;
+    }
+
+private:
+    struct entry
+    {
+        cache_key key;
+        std::shared_ptr<const void> payload;
+        size_t bytes;
+    };
+
+    std::mutex m_mutex;
+    std::list<entry> m_entries; // most recently used first
+    std::unordered_map<cache_key, std::list<entry>::iterator, cache_key_hash> m_index;
+    size_t m_budget;
+    size_t m_size;
+    size_t m_hits, m_misses, m_evictions;
+};
+
+template<typename T, typename Allocator>
+size_t payload_bytes(const std::vector<T, Allocator> &payload)
+{
+    return payload.size() * sizeof(T);
+}
+
+/**
+ * Handle to a decoded payload that can be dropped under memory pressure and
+ * rebuilt from its source on the next get().
+ *
+ * Without a cache the payload stays resident in the handle. A handle created
+ * with only a loader decodes on every get() and keeps nothing.
+ */
+template<typename T>
+class cached
+{
+public:
+    using loader = std::function<std::shared_ptr<T>()>;
+
+    cached() = default;
+
+    cached(std::shared_ptr<resource_cache> cache, cache_key key, std::shared_ptr<T> payload, loader reload) :
+            m_cache(cache),
+            m_key(key),
+            m_reload(reload)
+    {
+        if (m_cache)
+        {
+            if (payload)
+            {
+                m_cache->insert(m_key, payload, payload_bytes(*payload));
+            }
+        } else
+        {
+            m_resident = payload;
+        }
+    }
+
+    std::shared_ptr<const T> get() const
+    {
+        if (m_resident || !m_reload)
+        {
+            return m_resident;
+        }
+
+        if (m_cache)
+        {
+            if (auto hit = m_cache->find(m_key))
+            {
+                return std::static_pointer_cast<const T>(hit);
+            }
+        }
+
+        auto payload = m_reload();
+
+        if (m_cache && payload)
+        {
+            m_cache->insert(m_key, payload, payload_bytes(*payload));
+        }
+
+        return payload;
+    }
+
+    explicit operator bool() const
+    {
+        return m_resident || m_reload;
+    }
+
+private:
+    std::shared_ptr<resource_cache> m_cache;
+    cache_key m_key{};
+    std::shared_ptr<const T> m_resident;
+    loader m_reload;
+};
+
+
+#endif //EXPLORER_RESOURCE_CACHE_HPP
@@ -0,0 +1,480 @@
+#include <csignal>
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "resource_server.hpp"
+#include "scene_export.hpp"
+#include "trace.hpp"
+
+void resource_server::client::send(std::string bytes)
+{
+    auto owned = std::make_shared<std::string>(std::move(bytes));
+    send(owned, owned->data(), owned->size());
+}
+
+void resource_server::client::send(std::shared_ptr<const void> owner, const void *data, size_t size)
+{
+    if (size > 0)
+    {
+        output.push_back({std::move(owner), (const char *) data, size});
+    }
+}
+
+void resource_server::client::send_response(std::string body)
+{
+    send(string_format("OK %zu\n", body.size()));
+    send(std::move(body));
+}
+
+void resource_server::client::send_error(const std::string &message)
+{
+    send(string_format("ERR %s\n", message.c_str()));
+}
+
+bool resource_server::client::flush(int fd)
+{
+    while (!output.empty())
+    {
+        struct iovec iov[16];
+        auto count = 0;
+
+        for (auto &segment : output)
+        {
+            if (count == 16) break;
+            iov[count++] = {(void *) segment.data, segment.size};
+        }
+
+        auto written = writev(fd, iov, count);
+
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        // Drop fully written segments and advance into a partially written one.
+        while (!output.empty() && (size_t) written >= output.front().size)
+        {
+            written -= output.front().size;
+            output.pop_front();
+        }
+
+        if (!output.empty())
+        {
+            output.front().data += written;
+            output.front().size -= written;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * The world-space box around an object's header bounds, placed with its full
+ * transform. Each world axis gathers the smaller and larger product of every
+ * matrix entry with the box's extent, which gives the tight box around the
+ * eight transformed corners.
+ */
+static void world_bounds(const solid_object &object, float min[3], float max[3])
+{
+    auto m = object.placement();
+    float low[] = {object.min_point.x, object.min_point.y, object.min_point.z};
+    float high[] = {object.max_point.x, object.max_point.y, object.max_point.z};
+
+    for (auto column = 0; column < 3; column++)
+    {
+        min[column] = max[column] = m.m[12 + column];
+
+        for (auto row = 0; row < 3; row++)
+        {
+            auto a = low[row] * m.m[row * 4 + column];
+            auto b = high[row] * m.m[row * 4 + column];
+
+            min[column] += std::min(a, b);
+            max[column] += std::max(a, b);
+        }
+    }
+}
+
+resource_server::resource_server(std::string socket_path) : m_socket_path(socket_path), m_socket(-1), m_running(false)
+{
+}
+
+resource_server::~resource_server()
+{
+    if (m_socket >= 0)
+    {
+        close(m_socket);
+        unlink(m_socket_path.c_str());
+    }
+}
+
+void resource_server::load(const std::string &filename)
+{
+    TRACE_SCOPE_FMT("resource_server::load", "%s", filename.c_str());
+
+    loaded_bundle bundle;
+    bundle.filename = filename;
+    bundle.chunks = std::make_shared<chunk_stream>(byte_source::open(filename));
+    bundle.chunks->set_cache(m_cache);
+
+    while (bundle.chunks->data_remaining())
+    {
+        auto chunk = bundle.chunks->read_chunk();
+
+        bundle.chunks->process_chunk(chunk);
+        bundle.chunks->skip_chunk(chunk);
+    }
+
+    for (auto &resource : bundle.chunks->resources)
+    {
+        if (auto tp = std::dynamic_pointer_cast<texture_pack>(resource))
+        {
+            for (auto &texture : tp->textures)
+            {
+                m_textures[texture->texture_hash] = texture;
+            }
+        } else if (auto slp = std::dynamic_pointer_cast<solid_list>(resource))
+        {
+            for (auto &object : slp->solid_objects)
+            {
+                m_objects[object.hash] = &object;
+                m_objects_by_name[object.name] = &object;
+                m_lists[&object] = slp.get();
+            }
+        }
+    }
+
+    m_bundles.push_back(std::move(bundle));
+}
+
+void resource_server::run()
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if (m_socket_path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error(string_format("Socket path too long: %s", m_socket_path.c_str()));
+    }
+
+    strcpy(address.sun_path, m_socket_path.c_str());
+
+    // A client hanging up mid-response must not kill the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(m_socket_path.c_str());
+
+    if (m_socket < 0
+        || bind(m_socket, (sockaddr *) &address, sizeof(address)) < 0
+        || listen(m_socket, 16) < 0)
+    {
+        throw std::runtime_error(string_format("Can't listen on %s: %s", m_socket_path.c_str(), strerror(errno)));
+    }
+
+    m_running = true;
+
+    // One poll loop serves every client over non-blocking sockets, so a client
+    // that sends nothing, or stops reading a large response, doesn't hold up
+    // the others. A client's next requests are only read once its output has
+    // been sent, which bounds what is queued for it. After SHUTDOWN, queued
+    // output is still sent for up to kShutdownDrainMs without progress.
+    const int kShutdownDrainMs = 1000;
+
+    std::vector<pollfd> descriptors{{m_socket, POLLIN, 0}};
+    std::unordered_map<int, client> clients;
+
+    auto drop = [&](size_t i)
+    {
+        close(descriptors[i].fd);
+        clients.erase(descriptors[i].fd);
+        descriptors.erase(descriptors.begin() + i);
+    };
+
+    while (true)
+    {
+        for (auto i = descriptors.size() - 1; i > 0; i--)
+        {
+            auto &client = clients[descriptors[i].fd];
+
+            if (!client.output.empty())
+            {
+                descriptors[i].events = POLLOUT;
+            } else if (m_running)
+            {
+                descriptors[i].events = POLLIN;
+            } else
+            {
+                drop(i);
+            }
+        }
+
+        descriptors[0].events = m_running ? POLLIN : 0;
+
+        if (!m_running && descriptors.size() == 1)
+        {
+            break;
+        }
+
+        auto ready = poll(descriptors.data(), descriptors.size(), m_running ? -1 : kShutdownDrainMs);
+
+        if (ready < 0)
+        {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(string_format("poll() failed: %s", strerror(errno)));
+        }
+
+        if (ready == 0)
+        {
+            break;
+        }
+
+        for (auto i = descriptors.size() - 1; i > 0; i--)
+        {
+            auto fd = descriptors[i].fd;
+            auto revents = descriptors[i].revents;
+            auto &client = clients[fd];
+            auto open = true;
+
+            if (revents & POLLOUT)
+            {
+                open = client.flush(fd);
+            } else if (revents != 0 && m_running)
+            {
+                open = read_requests(fd, client) && client.flush(fd);
+            } else if (revents != 0)
+            {
+                open = false;
+            }
+
+            if (!open || (client.closing && client.output.empty()))
+            {
+                drop(i);
+            }
+        }
+
+        if (m_running && (descriptors[0].revents & POLLIN))
+        {
+            auto fd = accept4(m_socket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+            if (fd >= 0)
+            {
+                descriptors.push_back({fd, POLLIN, 0});
+            } else if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN)
+            {
+                throw std::runtime_error(string_format("accept() failed: %s", strerror(errno)));
+            }
+        }
+    }
+
+    for (auto i = descriptors.size() - 1; i > 0; i--)
+    {
+        drop(i);
+    }
+}
+
+bool resource_server::read_requests(int fd, client &client)
+{
+    char buffer[4096];
+    ssize_t received;
+
+    do
+    {
+        received = read(fd, buffer, sizeof(buffer));
+    } while (received < 0 && errno == EINTR);
+
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        return true;
+    }
+
+    if (received <= 0)
+    {
+        return false;
+    }
+
+    auto &pending = client.input;
+    pending.append(buffer, (size_t) received);
+
+    for (auto newline = pending.find('\n'); newline != std::string::npos; newline = pending.find('\n'))
+    {
+        auto request = pending.substr(0, newline);
+        pending.erase(0, newline + 1);
+
+        if (!request.empty() && request.back() == '\r')
+        {
+            request.pop_back();
+        }
+
+        if (!handle_request(client, request) || !m_running)
+        {
+            client.closing = true;
+            pending.clear();
+            return true;
+        }
+    }
+
+    if (pending.size() > kMaxRequestBytes)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool resource_server::handle_request(client &client, const std::string &request)
+{
+    std::istringstream args(request);
+    std::string command;
+    args >> command;
+
+    if (command == "LIST")
+    {
+        std::ostringstream body;
+
+        for (auto &entry : m_textures)
+        {
+            auto &texture = entry.second;
+            write_line(body, string_format("texture %08X %ux%u %u %s", texture->texture_hash, texture->width,
+                                           texture->height, texture->data_size, texture->name.c_str()));
+        }
+
+        for (auto &entry : m_objects)
+        {
+            auto &object = entry.second;
+            write_line(body, string_format("object %08X %s", object->hash, object->name.c_str()));
+        }
+
+        client.send_response(body.str());
+        return true;
+    } else if (command == "TEXTURE")
+    {
+        std::string key;
+        args >> key;
+
+        auto it = m_textures.find((unsigned int) strtoul(key.c_str(), nullptr, 16));
+
+        if (key.empty() || it == m_textures.end())
+        {
+            client.send_error("unknown texture " + key);
+            return true;
+        }
+
+        // The payload is queued in place; the queue keeps it alive until it is sent.
+        auto &texture = it->second;
+        auto header = texture->dds_header();
+        auto payload = texture->data.get();
+        std::string dds_header((const char *) &DirectX::DDS_MAGIC, 4);
+        dds_header.append((const char *) &header, sizeof(header));
+
+        client.send(string_format("OK %zu\n", dds_header.size() + payload->size()));
+        client.send(std::move(dds_header));
+        client.send(payload, payload->data(), payload->size());
+        return true;
+    } else if (command == "MESH" || command == "MATERIALS")
+    {
+        std::string key;
+        args >> key;
+
+        auto object = find_object(key);
+
+        if (!object || !object->mesh)
+        {
+            client.send_error("unknown object " + key);
+            return true;
+        }
+
+        std::string format;
+        args >> format;
+
+        std::ostringstream body(std::ios::binary);
+
+        if (command == "MESH" && format == "glb")
+        {
+            scene_builder scene;
+            scene.add(*object, m_lists.at(object)->pipeline_path);
+            scene.write_glb(body);
+        } else if (command == "MESH" && (format.empty() || format == "obj"))
+        {
+            object->write_obj(body, object->name + ".mtl");
+        } else if (command == "MESH")
+        {
+            client.send_error("unknown mesh format " + format);
+            return true;
+        } else
+        {
+            object->write_mtl(body);
+        }
+
+        client.send_response(body.str());
+        return true;
+    } else if (command == "QUERY")
+    {
+        float box[6];
+
+        if (!(args >> box[0] >> box[1] >> box[2] >> box[3] >> box[4] >> box[5]))
+        {
+            client.send_error("usage: QUERY <x0> <y0> <z0> <x1> <y1> <z1>");
+            return true;
+        }
+
+        vector3 box_min{box[0], box[1], box[2]};
+        vector3 box_max{box[3], box[4], box[5]};
+        std::ostringstream body;
+
+        for (auto &entry : m_objects)
+        {
+            auto &object = entry.second;
+            float object_min[3], object_max[3];
+
+            world_bounds(*object, object_min, object_max);
+
+            if (object_min[0] <= box_max.x && object_max[0] >= box_min.x
+                && object_min[1] <= box_max.y && object_max[1] >= box_min.y
+                && object_min[2] <= box_max.z && object_max[2] >= box_min.z)
+            {
+                write_line(body, string_format("object %08X %s", object->hash, object->name.c_str()));
+            }
+        }
+
+        client.send_response(body.str());
+        return true;
+    } else if (command == "QUIT")
+    {
+        return false;
+    } else if (command == "SHUTDOWN")
+    {
+        m_running = false;
+        client.send_response("");
+        return false;
+    }
+
+    client.send_error("unknown command " + command);
+    return true;
+}
+
+const solid_object *resource_server::find_object(const std::string &key) const
+{
+    auto by_name = m_objects_by_name.find(key);
+
+    if (by_name != m_objects_by_name.end())
+    {
+        return by_name->second;
+    }
+
+    char *end = nullptr;
+    auto hash = (unsigned int) strtoul(key.c_str(), &end, 16);
+
+    if (key.empty() || *end != '\0')
+    {
+        return nullptr;
+    }
+
+    auto by_hash = m_objects.find(hash);
+
+    return by_hash != m_objects.end() ? by_hash->second : nullptr;
+}
@@ -0,0 +1,129 @@
+#ifndef EXPLORER_RESOURCE_SERVER_HPP
+#define EXPLORER_RESOURCE_SERVER_HPP
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "chunk_stream.hpp"
+#include "solid_list_stream.hpp"
+#include "texture_pack_stream.hpp"
+
+/**
+ * Keeps a set of parsed bundles resident and answers requests about them over
+ * a Unix domain socket.
+ *
+ * Requests are single text lines, responses are "OK <length>\n" followed by
+ * length bytes of body, or "ERR <message>\n":
+ *
+ *     LIST                               one line per texture and object
+ *     TEXTURE <hash>                     the texture as a DDS file
+ *     MESH <name|hash> [obj|glb]         the object as an OBJ file, or as a binary glTF
+ *     MATERIALS <name|hash>              the object's MTL file
+ *     QUERY <x0> <y0> <z0> <x1> <y1> <z1> objects whose placed bounds intersect the box
+ *     QUIT                               close the connection
+ *     SHUTDOWN                           stop the server
+ */
+class resource_server
+{
+public:
+    explicit resource_server(std::string socket_path);
+
+    ~resource_server();
+
+    /**
+     * Cache for the payloads of bundles loaded from now on. Null keeps them resident.
+     */
+    void set_cache(std::shared_ptr<resource_cache> cache)
+    {
+        m_cache = cache;
+    }
+
+    /**
+     * Parses a bundle and adds its resources to the indices.
+     */
+    void load(const std::string &filename);
+
+    /**
+     * Accepts and serves connections until a SHUTDOWN request arrives.
+     */
+    void run();
+
+    resource_server(const resource_server &) = delete;
+
+    resource_server &operator=(const resource_server &) = delete;
+
+private:
+    struct loaded_bundle
+    {
+        std::string filename;
+        std::shared_ptr<chunk_stream> chunks;
+    };
+
+    /**
+     * Bytes queued for a client, owned by whatever keeps them alive (a
+     * resident texture payload, or a rendered response).
+     */
+    struct output_segment
+    {
+        std::shared_ptr<const void> owner;
+        const char *data;
+        size_t size;
+    };
+
+    struct client
+    {
+        std::string input; // received bytes not yet ending in a newline
+        std::deque<output_segment> output;
+        bool closing = false; // close once the output has been sent
+
+        void send(std::string bytes);
+
+        void send(std::shared_ptr<const void> owner, const void *data, size_t size);
+
+        void send_response(std::string body);
+
+        void send_error(const std::string &message);
+
+        /**
+         * Writes as much queued output as the socket takes without blocking.
+         *
+         * @return false if the connection failed
+         */
+        bool flush(int fd);
+    };
+
+    /** Longest request line accepted; a client that sends more without a newline is dropped. */
+    static const size_t kMaxRequestBytes = 4096;
+
+    std::string m_socket_path;
+    int m_socket;
+    bool m_running;
+    std::shared_ptr<resource_cache> m_cache;
+    std::vector<loaded_bundle> m_bundles;
+    std::unordered_map<unsigned int, std::shared_ptr<texture>> m_textures;
+    std::unordered_map<unsigned int, const solid_object *> m_objects;
+    std::unordered_map<std::string, const solid_object *> m_objects_by_name;
+    std::unordered_map<const solid_object *, const solid_list *> m_lists;
+
+    /**
+     * Reads what the client has sent and queues the answers to every complete
+     * request line.
+     *
+     * @return false once the connection should be closed without further output
+     */
+    bool read_requests(int fd, client &client);
+
+    /**
+     * Queues the answer to one request.
+     *
+     * @return false if the connection should be closed once the answer is sent
+     */
+    bool handle_request(client &client, const std::string &request);
+
+    const solid_object *find_object(const std::string &key) const;
+};
+
+
+#endif //EXPLORER_RESOURCE_SERVER_HPP
@@ -0,0 +1,259 @@
+#include "scene_export.hpp"
+#include <fstream>
+
+const unsigned int kGltfArrayBuffer = 34962;
+const unsigned int kGltfElementArrayBuffer = 34963;
+const unsigned int kGltfFloat = 5126;
+const unsigned int kGltfUnsignedInt = 5125;
+
+static std::string join(const std::vector<std::string> &items)
+{
+    std::string result;
+
+    for (auto &item : items)
+    {
+        result += (result.empty() ? "" : ",") + item;
+    }
+
+    return result;
+}
+
+/**
+ * Converts a row-major World transform to a column-major glTF node matrix in
+ * the Y/Z-swapped space the vertices are exported in. A row-major matrix for
+ * row vectors has the same memory layout as its column-major counterpart for
+ * column vectors, so only the axis swap remains.
+ */
+static std::string node_matrix(const matrix4 &m)
+{
+    static const int swap[] = {0, 2, 1, 3};
+    std::string result;
+
+    for (auto column = 0; column < 4; column++)
+    {
+        for (auto row = 0; row < 4; row++)
+        {
+            result += string_format("%s%.9g", result.empty() ? "" : ",", m.m[swap[column] * 4 + swap[row]]);
+        }
+    }
+
+    return "[" + result + "]";
+}
+
+size_t scene_builder::add_buffer_view(const void *data, size_t size, unsigned int target)
+{
+    auto offset = m_buffer.size();
+
+    m_buffer.append((const char *) data, size);
+    m_buffer.resize((m_buffer.size() + 3) & ~(size_t) 3, '\0');
+    m_buffer_views.push_back(string_format(R"({"buffer":0,"byteOffset":%zu,"byteLength":%zu,"target":%u})", offset,
+                                           size, target));
+
+    return m_buffer_views.size() - 1;
+}
+
+size_t scene_builder::add_material(const solid_mesh_material &material)
+{
+    // Materials with the same name can use different textures.
+    auto key = std::make_pair(material.name, material.texture_hash);
+    auto it = m_material_by_key.find(key);
+
+    if (it != m_material_by_key.end())
+    {
+        return it->second;
+    }
+
+    m_materials.push_back(string_format(R"({"name":"%s","extras":{"texture_hash":"%08X"}})",
+                                        json_escape(material.name).c_str(), material.texture_hash));
+
+    return m_material_by_key[key] = m_materials.size() - 1;
+}
+
+size_t scene_builder::add_mesh(const solid_object &object)
+{
+    auto it = m_mesh_by_hash.find(object.hash);
+
+    if (it != m_mesh_by_hash.end())
+    {
+        return it->second;
+    }
+
+    auto &mesh = *object.mesh;
+    std::vector<float> positions, tex_coords;
+
+    for (auto &vb : mesh.vertex_buffers)
+    {
+        for (auto &vertex : vb.decode(*vb.data.get()))
+        {
+            positions.insert(positions.end(), {vertex.x, vertex.y, vertex.z});
+            tex_coords.insert(tex_coords.end(), {vertex.u, vertex.v});
+        }
+    }
+
+    auto num_vertices = positions.size() / 3;
+    std::string primitives;
+
+    if (num_vertices > 0)
+    {
+        float min[] = {positions[0], positions[1], positions[2]};
+        float max[] = {positions[0], positions[1], positions[2]};
+
+        for (auto i = 0u; i < positions.size(); i++)
+        {
+            min[i % 3] = std::min(min[i % 3], positions[i]);
+            max[i % 3] = std::max(max[i % 3], positions[i]);
+        }
+
+        auto position_view = add_buffer_view(positions.data(), positions.size() * sizeof(float), kGltfArrayBuffer);
+        m_accessors.push_back(string_format(
+                R"({"bufferView":%zu,"componentType":%u,"count":%zu,"type":"VEC3","min":[%.9g,%.9g,%.9g],"max":[%.9g,%.9g,%.9g]})",
+                position_view, kGltfFloat, num_vertices, min[0], min[1], min[2], max[0], max[1], max[2]));
+        auto position_accessor = m_accessors.size() - 1;
+
+        auto uv_view = add_buffer_view(tex_coords.data(), tex_coords.size() * sizeof(float), kGltfArrayBuffer);
+        m_accessors.push_back(string_format(R"({"bufferView":%zu,"componentType":%u,"count":%zu,"type":"VEC2"})",
+                                            uv_view, kGltfFloat, num_vertices));
+        auto uv_accessor = m_accessors.size() - 1;
+
+        auto faces = mesh.faces.get();
+        auto face_idx = 0u;
+
+        for (auto &material : mesh.materials)
+        {
+            std::vector<unsigned int> indices;
+            auto end = std::min<size_t>(face_idx + material.num_tris, faces->size());
+
+            for (auto i = face_idx; i < end; i++)
+            {
+                auto &face = (*faces)[i];
+
+                if (face.face1 < num_vertices && face.face2 < num_vertices && face.face3 < num_vertices)
+                {
+                    indices.insert(indices.end(), {face.face1, face.face2, face.face3});
+                }
+            }
+
+            face_idx += material.num_tris;
+
+            if (indices.empty())
+            {
+                continue;
+            }
+
+            auto index_view = add_buffer_view(indices.data(), indices.size() * sizeof(unsigned int),
+                                              kGltfElementArrayBuffer);
+            m_accessors.push_back(string_format(R"({"bufferView":%zu,"componentType":%u,"count":%zu,"type":"SCALAR"})",
+                                                index_view, kGltfUnsignedInt, indices.size()));
+
+            primitives += string_format(
+                    R"(%s{"attributes":{"POSITION":%zu,"TEXCOORD_0":%zu},"indices":%zu,"material":%zu})",
+                    primitives.empty() ? "" : ",", position_accessor, uv_accessor, m_accessors.size() - 1,
+                    add_material(material));
+        }
+    }
+
+    // glTF meshes need at least one primitive; empty ones become points.
+    if (primitives.empty())
+    {
+        float origin[] = {0, 0, 0};
+        auto view = add_buffer_view(origin, sizeof(origin), kGltfArrayBuffer);
+        m_accessors.push_back(string_format(
+                R"({"bufferView":%zu,"componentType":%u,"count":1,"type":"VEC3","min":[0,0,0],"max":[0,0,0]})", view,
+                kGltfFloat));
+        primitives = string_format(R"({"attributes":{"POSITION":%zu},"mode":0})", m_accessors.size() - 1);
+    }
+
+    m_meshes.push_back(string_format(R"({"name":"%08X","primitives":[%s]})", object.hash, primitives.c_str()));
+
+    return m_mesh_by_hash[object.hash] = m_meshes.size() - 1;
+}
+
+void scene_builder::add(const solid_list &list)
+{
+    for (auto &object : list.solid_objects)
+    {
+        add(object, list.pipeline_path);
+    }
+}
+
+void scene_builder::add(const solid_object &object, const std::string &pipeline_path)
+{
+    if (!object.mesh)
+    {
+        return;
+    }
+
+    auto mesh = add_mesh(object);
+
+    m_nodes.push_back(string_format(
+            R"({"name":"%s","mesh":%zu,"matrix":%s,"extras":{"hash":"%08X","pipeline_path":"%s"}})",
+            json_escape(object.name).c_str(), mesh, node_matrix(object.placement()).c_str(), object.hash,
+            json_escape(pipeline_path).c_str()));
+}
+
+void scene_builder::write_glb(const std::string &filename) const
+{
+    std::ofstream stream(filename, std::ios::trunc | std::ios::binary);
+
+    write_glb(stream);
+
+    if (!stream)
+    {
+        throw std::runtime_error(string_format("Failed to write %s", filename.c_str()));
+    }
+}
+
+void scene_builder::write_glb(std::ostream &stream) const
+{
+    std::vector<std::string> node_indices;
+
+    for (auto i = 0u; i < m_nodes.size(); i++)
+    {
+        node_indices.push_back(string_format("%u", i));
+    }
+
+    std::vector<std::string> members = {
+            R"("asset":{"version":"2.0","generator":"Explorer"})",
+            R"("scene":0)",
+            node_indices.empty() ? R"("scenes":[{}])" : string_format(R"("scenes":[{"nodes":[%s]}])",
+                                                                        join(node_indices).c_str())
+    };
+
+    // The schema doesn't allow empty arrays, so leave out empty ones.
+    auto add_array = [&members](const char *key, const std::vector<std::string> &items)
+    {
+        if (!items.empty())
+        {
+            members.push_back(string_format(R"("%s":[%s])", key, join(items).c_str()));
+        }
+    };
+
+    add_array("nodes", m_nodes);
+    add_array("meshes", m_meshes);
+    add_array("materials", m_materials);
+    add_array("accessors", m_accessors);
+    add_array("bufferViews", m_buffer_views);
+
+    if (!m_buffer.empty())
+    {
+        members.push_back(string_format(R"("buffers":[{"byteLength":%zu}])", m_buffer.size()));
+    }
+
+    auto json = "{" + join(members) + "}";
+    json.resize((json.size() + 3) & ~(size_t) 3, ' ');
+
+    auto total = 12 + 8 + json.size() + (m_buffer.empty() ? 0 : 8 + m_buffer.size());
+    unsigned int header[] = {0x46546C67, 2, (unsigned int) total}; // "glTF"
+    unsigned int json_header[] = {(unsigned int) json.size(), 0x4E4F534A}; // "JSON"
+    unsigned int bin_header[] = {(unsigned int) m_buffer.size(), 0x004E4942}; // "BIN\0"
+
+    stream.write((const char *) header, sizeof(header));
+    stream.write((const char *) json_header, sizeof(json_header));
+    stream.write(json.data(), json.size());
+
+    if (!m_buffer.empty())
+    {
+        stream.write((const char *) bin_header, sizeof(bin_header));
+        stream.write(m_buffer.data(), m_buffer.size());
+    }
+}
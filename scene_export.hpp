@@ -0,0 +1,67 @@
+#ifndef EXPLORER_SCENE_EXPORT_HPP
+#define EXPLORER_SCENE_EXPORT_HPP
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "solid_list_stream.hpp"
+
+/**
+ * Assembles the solid objects of one or more bundles into a single glTF 2.0
+ * scene, written as a binary .glb file.
+ *
+ * Every object becomes a node carrying its full transform. Meshes are keyed by
+ * object hash, so objects that share a hash are instances of one glTF mesh.
+ * Positions get the same Y/Z swap as OBJ export, applied to the node
+ * transforms as well. Materials keep their name; the texture hash is stored
+ * in the material's extras because glTF has no core support for DDS.
+ */
+class scene_builder
+{
+public:
+    void add(const solid_list &list);
+
+    /**
+     * Adds one object as a node. Objects without a mesh are skipped.
+     */
+    void add(const solid_object &object, const std::string &pipeline_path);
+
+    void write_glb(const std::string &filename) const;
+
+    void write_glb(std::ostream &stream) const;
+
+    size_t num_nodes() const
+    {
+        return m_nodes.size();
+    }
+
+    size_t num_meshes() const
+    {
+        return m_meshes.size();
+    }
+
+private:
+    std::string m_buffer;
+    std::vector<std::string> m_buffer_views;
+    std::vector<std::string> m_accessors;
+    std::vector<std::string> m_meshes;
+    std::vector<std::string> m_materials;
+    std::vector<std::string> m_nodes;
+    std::map<unsigned int, size_t> m_mesh_by_hash;
+    std::map<std::pair<std::string, unsigned int>, size_t> m_material_by_key;
+
+    /**
+     * Appends data to the binary buffer as a new buffer view.
+     *
+     * @return the buffer view's index
+     */
+    size_t add_buffer_view(const void *data, size_t size, unsigned int target);
+
+    size_t add_mesh(const solid_object &object);
+
+    size_t add_material(const solid_mesh_material &material);
+};
+
+
+#endif //EXPLORER_SCENE_EXPORT_HPP
@@ -2,146 +2,161 @@
 #include <map>
 #include <cassert>
 #include "solid_list_stream.hpp"
+#include "chunk_tree.hpp"
+#include "trace.hpp"
+#include "thread_pool.hpp"
 
-struct PACK solid_list_info_struct
+solid_list_stream::solid_list_stream(chunk_stream *chunk_stream, std::shared_ptr<chunk> chunk, bool headers_only)
 {
-    unsigned long long blank;
-    unsigned int unknown1;
-    unsigned int object_count;
-    char pipeline_path[0x38];
-    char class_type[0x20];
-    unsigned long long blank2;
-    unsigned int unknown_offset;
-};
-
-struct PACK solid_object_header_struct
-{
-    unsigned int blank1;
-    unsigned int blank2;
-    unsigned int blank3;
-    unsigned int unknown1;
-    unsigned int hash;
-    unsigned int num_tris;
-    unsigned int unknown2;
-    unsigned int unknown3;
-    float bounds_min[4];
-    float bounds_max[4];
-    float transform[16]; // 4x4 matrix
-    unsigned int blank4[6];
-    float unknown4[2];
-};
-
-struct PACK mesh_descriptor_struct
-{
-    unsigned long long unknown1;
-    unsigned int unknown2;
-    unsigned int flags;
-    unsigned int num_materials;
-    unsigned int blank1;
-    unsigned int num_vertex_buffers;
-    unsigned int blank2[3];
-    unsigned int num_tris;
-    unsigned int num_indices;
-    unsigned int blank3;
-};
-
-struct PACK mesh_material_struct
-{
-    unsigned int flags;
-    unsigned int hash;
-    unsigned int unknown1, unknown2;
-    float min_point[3];
-    float max_point[3];
-    unsigned int unknown3;
-    unsigned char texture_assignments[4];
-    unsigned char unknown4[16];
-    unsigned int num_vertices;
-    unsigned int num_indices;
-    unsigned int num_tris;
-    unsigned int offset; // index buffer, not triangles
-    unsigned char unknown5[36];
-};
-
-static_assert(sizeof(mesh_material_struct) == 116);
-
-solid_list_stream::solid_list_stream(chunk_stream *chunk_stream, std::shared_ptr<chunk> chunk)
-{
-    this->m_named_materials = 0;
-    this->m_object_count = 0;
+    this->m_headers_only = headers_only;
     this->m_solid_list.reset(new solid_list);
     this->m_chunk_stream = chunk_stream;
-    this->read_chunks(chunk->offset, chunk->length, chunk_stream);
+
+    this->read_chunks<GAME_WORLD>(chunk->offset, chunk->length);
 //    this->debug();
 }
 
-void solid_list_stream::read_chunks(unsigned int offset, unsigned int length, chunk_stream *stream)
+template<game_id Game>
+void solid_list_stream::read_chunks(unsigned int offset, unsigned int length)
 {
-    auto tmpStream = m_chunk_stream->substream(offset, length);
+    // Phase one: read the list info and note where each object is.
+    std::vector<::chunk> object_chunks;
+    object_state list_state;
 
-    while (tmpStream->data_remaining())
-    {
-        auto tmpChunk = tmpStream->read_chunk();
+    chunk_tree tree(*m_chunk_stream, offset, length);
 
-        if (tmpChunk->type == 0x80134010)
+    for (auto &entry : tree)
+    {
+        if (entry.chunk.type == 0x80134010)
         {
-            m_named_materials = 0;
-            m_current_object.reset(new solid_object);
-            m_solid_list->solid_objects[m_object_count++] = m_current_object;
+            object_chunks.push_back(entry.chunk);
+            tree.skip_children();
+        } else if (!entry.chunk.is_parent)
+        {
+            auto chunk = entry.chunk;
+            this->handle_chunk<Game>(chunk, m_chunk_stream, list_state);
         }
+    }
 
-        if (tmpChunk->is_parent)
-        {
-            read_chunks(tmpChunk->offset, tmpChunk->length, &*tmpStream);
-        } else
+    // Phase two: objects share no state, so each one is decoded on its own
+    // cursor into its own slot of one contiguous array.
+    auto &objects = m_solid_list->solid_objects;
+    objects = arena_array<solid_object>(*m_solid_list->storage, object_chunks.size());
+
+    for (auto i = 0u; i < object_chunks.size(); i++)
+    {
+        objects.emplace_back();
+    }
+
+    parallel_for(object_chunks.size(), [this, &object_chunks, &objects](size_t i)
+    {
+        read_object<Game>(object_chunks[i], objects[i]);
+    });
+}
+
+template<game_id Game>
+void solid_list_stream::read_object(const chunk &object_chunk, solid_object &object)
+{
+    auto stream = m_chunk_stream->substream(object_chunk.offset, object_chunk.length);
+
+    auto &filter = m_chunk_stream->get_object_filter();
+    auto headers_only = m_headers_only;
+
+    object_state state;
+    state.object = &object;
+    state.object->source_offset = object_chunk.offset;
+    state.object->source_length = object_chunk.length;
+
+    chunk_tree tree(*stream, object_chunk.offset, object_chunk.length);
+
+    for (auto &entry : tree)
+    {
+        if (headers_only)
         {
-            this->handle_chunk(tmpChunk, &*tmpStream);
+            // Everything nested inside an object besides its header is mesh data.
+            if (entry.chunk.is_parent)
+            {
+                tree.skip_children();
+                continue;
+            }
+
+            if (entry.chunk.type != 0x134011)
+            {
+                continue;
+            }
         }
 
-        tmpStream->skip_chunk(tmpChunk);
+        if (!entry.chunk.is_parent)
+        {
+            auto chunk = entry.chunk;
+            this->handle_chunk<Game>(chunk, stream.get(), state);
+
+            if (chunk.type == 0x134011 && filter && !filter(object))
+            {
+                headers_only = true;
+            }
+        }
     }
 }
 
-void solid_list_stream::handle_chunk(std::shared_ptr<chunk> chunk, chunk_stream *stream)
+template<game_id Game>
+void solid_list_stream::handle_chunk(chunk &chunk, chunk_stream *stream, object_state &state)
 {
-    switch (chunk->type)
+    using traits = game_traits<Game>;
+
+    TRACE_SCOPE_FMT("solid_list_stream::handle_chunk", "%08X @ %08X", chunk.type, chunk.offset);
+
+    auto &storage = *m_solid_list->storage;
+
+    // Payloads are only placed in the arena when they can't be evicted.
+    auto payload_arena = stream->cache() ? nullptr : &storage;
+
+    if (!state.object && chunk.type != 0x134002)
+    {
+        // Object data outside of an object chunk.
+        return;
+    }
+
+    switch (chunk.type)
     {
         case 0x134002:
         {
-            solid_list_info_struct solidListInfo{};
+            typename traits::solid_list_info_struct solidListInfo{};
             stream->read(&solidListInfo, sizeof(solidListInfo));
 
             m_solid_list->pipeline_path = std::string(solidListInfo.pipeline_path);
             m_solid_list->class_type = std::string(solidListInfo.class_type);
 
-            m_solid_list->solid_objects.resize(solidListInfo.object_count);
-
             break;
         }
         case 0x134011:
         {
             stream->align_padding(chunk);
-            auto solidObjectHeader = stream->read<solid_object_header_struct>();
-            auto name = m_chunk_stream->read_string();
-
-            m_current_object->name = name;
-            m_current_object->hash = solidObjectHeader.hash;
-            m_current_object->min_point.x = solidObjectHeader.bounds_min[0];
-            m_current_object->min_point.y = solidObjectHeader.bounds_min[1];
-            m_current_object->min_point.z = solidObjectHeader.bounds_min[2];
-            m_current_object->max_point.x = solidObjectHeader.bounds_max[0];
-            m_current_object->max_point.y = solidObjectHeader.bounds_max[1];
-            m_current_object->max_point.z = solidObjectHeader.bounds_max[2];
-            m_current_object->posX = solidObjectHeader.transform[12];
-            m_current_object->posY = solidObjectHeader.transform[13];
-            m_current_object->posZ = solidObjectHeader.transform[14];
+            auto solidObjectHeader = stream->read<typename traits::solid_object_header_struct>();
+            auto name = stream->read_string();
+
+            state.object->name = name;
+            state.object->hash = solidObjectHeader.hash;
+            state.object->min_point.x = solidObjectHeader.bounds_min[0];
+            state.object->min_point.y = solidObjectHeader.bounds_min[1];
+            state.object->min_point.z = solidObjectHeader.bounds_min[2];
+            state.object->max_point.x = solidObjectHeader.bounds_max[0];
+            state.object->max_point.y = solidObjectHeader.bounds_max[1];
+            state.object->max_point.z = solidObjectHeader.bounds_max[2];
+            state.object->posX = solidObjectHeader.transform[12];
+            state.object->posY = solidObjectHeader.transform[13];
+            state.object->posZ = solidObjectHeader.transform[14];
+            memcpy(state.object->transform.m, solidObjectHeader.transform, sizeof(matrix4));
 
             break;
         }
         case 0x134012:
         {
-            for (auto i = 0; i < chunk->length >> 3; i++)
+            state.object->texture_hashes = arena_array<unsigned int>(storage, chunk.length >> 3);
+
+            for (auto i = 0; i < chunk.length >> 3; i++)
             {
-                m_current_object->texture_hashes.push_back(stream->read<unsigned int>());
+                state.object->texture_hashes.emplace_back() = stream->read<unsigned int>();
                 stream->seek(4, SEEK_CUR);
             }
 
@@ -150,30 +165,49 @@ void solid_list_stream::handle_chunk(std::shared_ptr<chunk> chunk, chunk_stream
         case 0x134900:
         {
             stream->align_padding(chunk);
-            auto descriptor = stream->read<mesh_descriptor_struct>();
-
-            m_current_object->mesh.reset(new solid_mesh);
-            m_current_object->mesh->flags = descriptor.flags;
-            m_current_object->mesh->num_materials = descriptor.num_materials;
-            m_current_object->mesh->num_vertex_buffers = descriptor.num_vertex_buffers;
-            m_current_object->mesh->num_vertices = 0;
-            m_current_object->mesh->num_tris =
+            auto descriptor = stream->read<typename traits::mesh_descriptor_struct>();
+
+            state.object->mesh = storage.make<solid_mesh>();
+            state.object->mesh->vertex_buffers = arena_array<vertex_buffer>(storage, descriptor.num_vertex_buffers);
+            state.object->mesh->materials = arena_array<solid_mesh_material>(storage, descriptor.num_materials);
+            state.object->mesh->flags = descriptor.flags;
+            state.object->mesh->num_materials = descriptor.num_materials;
+            state.object->mesh->num_vertex_buffers = descriptor.num_vertex_buffers;
+            state.object->mesh->num_vertices = 0;
+            state.object->mesh->num_tris =
                     descriptor.num_tris == 0 ? descriptor.num_indices / 3 : descriptor.num_tris;
-            m_current_object->mesh->faces.resize(m_current_object->mesh->num_tris);
 
             break;
         }
         case 0x134b01:
         {
             stream->align_padding(chunk);
-            auto vb = std::make_shared<vertex_buffer>();
-            vb->position = 0;
-            vb->length = chunk->length / 4;
-            vb->data = (float *) calloc(vb->length, 4);
-
-            stream->read(vb->data, chunk->length);
+            auto &vb = state.object->mesh->vertex_buffers.emplace_back();
+            vb.position = 0;
+            vb.length = chunk.length / 4;
+            vb.source_offset = chunk.offset;
+
+            auto payload = std::allocate_shared<float_buffer>(arena_allocator<float_buffer>(payload_arena),
+                                                              (chunk.length + 3) / 4,
+                                                              arena_allocator<float>(payload_arena));
+            stream->read(payload->data(), chunk.length);
+
+            auto source = stream->source();
+            auto source_offset = vb.source_offset;
+            auto count = payload->size();
+            auto length = chunk.length;
+
+            // Only the chunk's own bytes are read back; a length that isn't a
+            // multiple of 4 leaves the last float zero-filled, as on first read.
+            vb.data = cached<float_buffer>(
+                    stream->cache(), cache_key{source->id(), 0x134b01, source_offset}, payload,
+                    [source, source_offset, count, length]()
+                    {
+                        auto data = std::make_shared<float_buffer>(count);
+                        source->read_at(data->data(), length, source_offset);
 
-            m_current_object->mesh->vertex_buffers.push_back(vb);
+                        return data;
+                    });
 
             break;
         }
@@ -184,10 +218,10 @@ void solid_list_stream::handle_chunk(std::shared_ptr<chunk> chunk, chunk_stream
             auto vertex_stream_index = 0u;
             auto last_unknown1 = 0;
 
-            for (auto i = 0; i < m_current_object->mesh->num_materials; i++)
+            for (auto i = 0; i < state.object->mesh->num_materials; i++)
             {
-                auto mat_struct = stream->read<mesh_material_struct>();
-                auto material = std::make_shared<solid_mesh_material>();
+                auto mat_struct = stream->read<typename traits::mesh_material_struct>();
+                auto &material = state.object->mesh->materials.emplace_back();
 
                 if (i == 0)
                 {
@@ -200,26 +234,25 @@ void solid_list_stream::handle_chunk(std::shared_ptr<chunk> chunk, chunk_stream
                     }
                 }
 
-                material->texture_hash = m_current_object->texture_hashes[mat_struct.texture_assignments[0]];
-                material->num_tris = mat_struct.num_tris == 0 ? mat_struct.num_indices / 3 : mat_struct.num_tris;
-                material->num_indices = mat_struct.num_indices;
-                material->num_vertices = mat_struct.num_vertices;
+                material.texture_hash = state.object->texture_hashes[mat_struct.texture_assignments[0]];
+                material.num_tris = mat_struct.num_tris == 0 ? mat_struct.num_indices / 3 : mat_struct.num_tris;
+                material.num_indices = mat_struct.num_indices;
+                material.num_vertices = mat_struct.num_vertices;
 
-                material->min_point.x = mat_struct.min_point[0];
-                material->min_point.y = mat_struct.min_point[1];
-                material->min_point.z = mat_struct.min_point[2];
+                material.min_point.x = mat_struct.min_point[0];
+                material.min_point.y = mat_struct.min_point[1];
+                material.min_point.z = mat_struct.min_point[2];
 
-                material->max_point.x = mat_struct.max_point[0];
-                material->max_point.y = mat_struct.max_point[1];
-                material->max_point.z = mat_struct.max_point[2];
+                material.max_point.x = mat_struct.max_point[0];
+                material.max_point.y = mat_struct.max_point[1];
+                material.max_point.z = mat_struct.max_point[2];
 
-                material->hash = mat_struct.hash;
-                material->name = string_format("unnamed-material-%08X", material->texture_hash);
+                material.hash = mat_struct.hash;
+                material.name = string_format("unnamed-material-%08X", material.texture_hash);
 
-                material->vertex_stream_index = vertex_stream_index;
+                material.vertex_stream_index = vertex_stream_index;
 
-                m_current_object->mesh->materials.push_back(material);
-                m_current_object->mesh->num_vertices += material->num_vertices;
+                state.object->mesh->num_vertices += material.num_vertices;
 
                 last_unknown1 = mat_struct.unknown1;
             }
@@ -230,45 +263,50 @@ void solid_list_stream::handle_chunk(std::shared_ptr<chunk> chunk, chunk_stream
         {
             stream->align_padding(chunk);
 
-            auto face_idx = 0;
-
-            for (auto i = 0; i < m_current_object->mesh->num_materials; i++)
-            {
-                auto &material = m_current_object->mesh->materials[i];
-
-                for (auto j = 0; j < material->num_tris; j++)
-                {
-                    auto face = &m_current_object->mesh->faces[face_idx + j];
+            auto &mesh = state.object->mesh;
+            std::vector<unsigned short> indices(mesh->num_raw_indices());
+            stream->read(indices.data(), indices.size() * sizeof(unsigned short));
 
-                    face->material_index = (unsigned char) i;
-                    stream->read(&face->face1, sizeof(unsigned short));
-                    stream->read(&face->face2, sizeof(unsigned short));
-                    stream->read(&face->face3, sizeof(unsigned short));
-                }
-
-                face_idx += material->num_tris;
-            }
+            // Faces stay resident and unrebased until process_data() runs.
+            mesh->faces_offset = chunk.offset;
+            state.faces = mesh->unpack_faces(indices.data(), payload_arena);
+            mesh->faces = cached<face_buffer>(nullptr, cache_key{}, state.faces, nullptr);
 
             break;
         }
         case 0x134c02:
         {
-            m_current_object->mesh->materials[m_named_materials]->name = stream->read_string();
-            m_current_object->mesh->materials[m_named_materials]->name += string_format("_%d", m_named_materials);
+            auto &material_name = state.object->mesh->materials[state.named_materials].name;
+            material_name = stream->read_string();
+            material_name += string_format("_%d", state.named_materials);
 
-            std::replace(m_current_object->mesh->materials[m_named_materials]->name.begin(), m_current_object->mesh->materials[m_named_materials]->name.end(), ' ', '_');
+            std::replace(material_name.begin(), material_name.end(), ' ', '_');
 
-            m_named_materials++;
+            state.named_materials++;
 
-            if (m_named_materials == m_current_object->mesh->num_materials)
+            if (state.named_materials == state.object->mesh->num_materials && state.faces)
             {
-                m_current_object->mesh->process_data();
+                auto mesh = state.object->mesh;
+                auto source = stream->source();
+
+                mesh->process_data(*state.faces);
+                mesh->faces = cached<face_buffer>(
+                        stream->cache(), cache_key{source->id(), 0x134b03, mesh->faces_offset}, state.faces,
+                        [source, mesh]()
+                        {
+                            auto indices = source->read_vector_at<unsigned short>(mesh->faces_offset,
+                                                                                  mesh->num_raw_indices());
+                            auto faces = mesh->unpack_faces(indices->data(), nullptr);
+                            mesh->rebase_faces(*faces);
+                            return faces;
+                        });
+                state.faces.reset();
             }
 
             break;
         }
         default:
-            if (chunk->type)
+            if (chunk.type)
             {
             }
 
@@ -281,81 +319,120 @@ void solid_list_stream::debug()
     for (auto &solid_object : this->m_solid_list->solid_objects)
     {
         std::string filename = string_format("%s-%s.obj", this->m_solid_list->class_type.c_str(),
-                                             solid_object->name.c_str());
+                                             solid_object.name.c_str());
         simple_filewriter sfw(filename);
 
-        sfw.write_line(string_format("g %s", solid_object->name.c_str()));
+        sfw.write_line(string_format("g %s", solid_object.name.c_str()));
 
-        for (auto &vb : solid_object->mesh->vertex_buffers)
+        for (auto &vb : solid_object.mesh->vertex_buffers)
         {
-            for (auto i = 0; i < vb->num_verts; i++)
+            auto vertices = vb.decode(*vb.data.get());
+
+            for (auto i = 0; i < vertices.size(); i++)
             {
-                auto vertex = vb->get_vertex();
-                sfw.write_line(string_format("# buffer - %d/%d", i + 1, vb->num_verts));
+                auto &vertex = vertices[i];
+                sfw.write_line(string_format("# buffer - %d/%d", i + 1, vb.num_verts));
                 sfw.write_line(string_format("v %f %f %f", vertex.x, vertex.y, vertex.z));
             }
         }
 
+        auto faces = solid_object.mesh->faces.get();
         auto faceIdx = 0;
 
-        for (auto i = 0; i < solid_object->mesh->num_materials; i++)
+        for (auto i = 0; i < solid_object.mesh->num_materials; i++)
         {
-            auto &material = solid_object->mesh->materials[i];
+            auto &material = solid_object.mesh->materials[i];
 
-            std::string mat_name(material->name);
+            std::string mat_name(material.name);
 
             std::replace(mat_name.begin(), mat_name.end(), ' ', '_');
 
             sfw.write_line(string_format("usemtl %s", mat_name.c_str()));
 
-            for (auto j = 0; j < material->num_tris; j++)
+            for (auto j = 0; j < material.num_tris; j++)
             {
-                auto face = solid_object->mesh->faces[faceIdx + j];
+                auto face = (*faces)[faceIdx + j];
 
                 sfw.write_line(string_format("f %d/%d %d/%d %d/%d", face.face1 + 1, face.face1 + 1, face.face2 + 1,
                                              face.face2 + 1, face.face3 + 1, face.face3 + 1));
             }
 
-            faceIdx += material->num_tris;
+            faceIdx += material.num_tris;
         }
     }
 }
 
-solid_mesh_vertex vertex_buffer::get_vertex()
+std::vector<solid_mesh_vertex> vertex_buffer::decode(const float_buffer &data) const
 {
-    float x = this->data[this->position + 0];
-    float y = this->data[this->position + 2];
-    float z = this->data[this->position + 1];
-    float u = this->data[this->position + 5];
-    float v = -this->data[this->position + 6];
-    unsigned int color = *reinterpret_cast<unsigned int *>(&this->data[this->position + 3]);
-
-    this->position += this->stride;
-
-    solid_mesh_vertex vertex{};
-    vertex.x = x;
-    vertex.y = y;
-    vertex.z = z;
-    vertex.u = u;
-    vertex.v = v;
-    vertex.color = color;
-
-    return vertex;
+    // Always num_verts vertices: faces index the buffers as if they were
+    // concatenated, so a short buffer is padded with zero vertices rather than
+    // shifting the indices of every later buffer.
+    std::vector<solid_mesh_vertex> vertices(this->num_verts, solid_mesh_vertex{});
+
+    if (this->stride != 0)
+    {
+        auto count = std::min<size_t>(this->num_verts, data.size() / this->stride);
+        decode_vertices(data.data(), count, this->stride, vertices.data());
+    }
+
+    return vertices;
+}
+
+unsigned int solid_mesh::num_raw_indices() const
+{
+    auto count = 0u;
+
+    for (auto &material : this->materials)
+    {
+        count += material.num_tris * 3;
+    }
+
+    return count;
+}
+
+std::shared_ptr<face_buffer> solid_mesh::unpack_faces(const unsigned short *indices, arena *arena) const
+{
+    auto faces = std::allocate_shared<face_buffer>(arena_allocator<face_buffer>(arena), this->num_tris,
+                                                   arena_allocator<solid_mesh_face>(arena));
+    auto face_idx = 0u;
+
+    for (auto i = 0; i < this->num_materials; i++)
+    {
+        auto &material = this->materials[i];
+
+        for (auto j = 0; j < material.num_tris; j++, indices += 3)
+        {
+            if (face_idx + j >= faces->size()) continue;
+
+            auto face = &(*faces)[face_idx + j];
+
+            face->material_index = (unsigned char) i;
+            face->face1 = indices[0];
+            face->face2 = indices[1];
+            face->face3 = indices[2];
+        }
+
+        face_idx += material.num_tris;
+    }
+
+    return faces;
 }
 
-void solid_mesh::process_data()
+void solid_mesh::process_data(face_buffer &faces)
 {
+    TRACE_SCOPE("solid_mesh::process_data");
+
     std::map<unsigned int, unsigned int> buffer_count_map;
 
     for (auto &material : this->materials)
     {
-        buffer_count_map[material->vertex_stream_index] = 0;
+        buffer_count_map[material.vertex_stream_index] = 0;
     }
 
     for (auto &material : this->materials)
     {
-        buffer_count_map[material->vertex_stream_index] += material->num_vertices;
-        this->vertex_buffers[material->vertex_stream_index]->num_verts += material->num_vertices;
+        buffer_count_map[material.vertex_stream_index] += material.num_vertices;
+        this->vertex_buffers[material.vertex_stream_index].num_verts += material.num_vertices;
     }
 
     auto numVerts = 0u;
@@ -364,33 +441,47 @@ void solid_mesh::process_data()
     for (auto i = 0; i < this->materials.size(); i++)
     {
         auto &material = this->materials[i];
-        auto stream_index = material->vertex_stream_index;
-        auto stream = this->vertex_buffers[stream_index];
+        auto stream_index = material.vertex_stream_index;
+        auto stream = &this->vertex_buffers[stream_index];
         auto stride = stream->length / stream->num_verts;
         auto shift = numVerts - stream->position / stride;
         auto vertCount = stream->num_verts;
 
         stream->stride = stride;
+        material.index_shift = shift;
 
         for (auto j = 0; j < vertCount; j++)
         {
             if (stream->position >= stream->length) break;
 
             stream->position += stride;
-//            if (this->vertex_buffers[stream_index]->position >= this->vertex_buffers[stream_index]->length) break;
-
-//            this->vertex_buffers[stream_index]->get_vertex();
             numVerts++;
         }
 
-        auto triCount = material->num_tris;
+        curFaceIdx += material.num_tris;
 
-        if (triCount == 0)
-        {
-            triCount = material->num_indices / 3;
-        }
+        if (curFaceIdx >= this->num_tris) break;
+    }
+
+    for (auto &vb : vertex_buffers)
+    {
+        vb.position = 0;
+    }
 
-        for (auto j = 0; j < triCount; j++)
+    rebase_faces(faces);
+}
+
+void solid_mesh::rebase_faces(face_buffer &faces) const
+{
+    auto curFaceIdx = 0u;
+
+    for (auto i = 0; i < this->materials.size(); i++)
+    {
+        auto &material = this->materials[i];
+        auto shift = material.index_shift;
+        auto triCount = material.num_tris;
+
+        for (auto j = 0; j < triCount && curFaceIdx + j < faces.size(); j++)
         {
             auto faceIdx = curFaceIdx + j;
             auto face = faces[faceIdx];
@@ -415,9 +506,4 @@ void solid_mesh::process_data()
 
         if (curFaceIdx >= this->num_tris) break;
     }
-
-    for (auto &vb : vertex_buffers)
-    {
-        vb->position = 0;
-    }
 }
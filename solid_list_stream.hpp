@@ -3,7 +3,12 @@
 
 #include <memory>
 #include <vector>
+#include "arena.hpp"
 #include "chunk_stream.hpp"
+#include "game_traits.hpp"
+#include "trace.hpp"
+#include "vertex_decode.hpp"
+#include "name_dictionary.hpp"
 #include <boost/filesystem.hpp>
 
 struct solid_mesh_face
@@ -15,16 +20,12 @@ public:
     unsigned char material_index;
 };
 
-struct solid_mesh_vertex
-{
-public:
-    float x;
-    float y;
-    float z;
-    unsigned int color;
-    float u;
-    float v;
-};
+/**
+ * Payload storage. Drawn from the solid list's arena when no cache is set;
+ * cached payloads live on the heap so that eviction frees them.
+ */
+using float_buffer = std::vector<float, arena_allocator<float>>;
+using face_buffer = std::vector<solid_mesh_face, arena_allocator<solid_mesh_face>>;
 
 struct vertex_buffer
 {
@@ -33,10 +34,15 @@ public:
     unsigned int length;
     unsigned int num_verts;
     unsigned int stride;
+    unsigned int source_offset;
 
-    float *data;
+    cached<float_buffer> data;
 
-    solid_mesh_vertex get_vertex();
+    /**
+     * Decodes num_verts vertices from the buffer's payload. Vertices past the
+     * end of a short payload are zero.
+     */
+    std::vector<solid_mesh_vertex> decode(const float_buffer &data) const;
 };
 
 struct solid_mesh_material
@@ -48,6 +54,7 @@ public:
     unsigned int hash;
     unsigned int texture_hash;
     unsigned int vertex_stream_index;
+    unsigned int index_shift; // added to this material's indices to make them mesh-global
     std::string name;
     vector3 min_point, max_point;
 };
@@ -61,11 +68,31 @@ public:
     unsigned int num_vertices;
     unsigned int num_tris;
 
-    std::vector<std::shared_ptr<vertex_buffer>> vertex_buffers;
-    std::vector<std::shared_ptr<solid_mesh_material>> materials;
-    std::vector<solid_mesh_face> faces;
+    unsigned int faces_offset; // source offset of the raw 0x134b03 index buffer
+
+    arena_array<vertex_buffer> vertex_buffers;
+    arena_array<solid_mesh_material> materials;
+    cached<face_buffer> faces;
+
+    /**
+     * @return number of raw indices in the 0x134b03 chunk
+     */
+    unsigned int num_raw_indices() const;
 
-    void process_data();
+    /**
+     * Splits the raw index buffer into faces in material order.
+     *
+     * @param arena storage for the faces; null for the heap
+     */
+    std::shared_ptr<face_buffer> unpack_faces(const unsigned short *indices, arena *arena) const;
+
+    /**
+     * Sizes the vertex buffers, works out each material's index shift and
+     * applies it to faces. Runs once, after all material names are read.
+     */
+    void process_data(face_buffer &faces);
+
+    void rebase_faces(face_buffer &faces) const;
 };
 
 class solid_object
@@ -74,10 +101,12 @@ public:
     std::string name;
     unsigned int hash;
     float posX, posY, posZ;
+    matrix4 transform; // row-major, translation in [12..14]
+    unsigned int source_offset, source_length; // extent of the 0x80134010 chunk payload
 
     vector3 min_point, max_point;
-    std::shared_ptr<solid_mesh> mesh;
-    std::vector<unsigned int> texture_hashes;
+    solid_mesh *mesh; // in the list's arena; null until the mesh header is read
+    arena_array<unsigned int> texture_hashes;
 
     solid_object()
     {
@@ -86,70 +115,105 @@ public:
         posX = 0.0f;
         posY = 0.0f;
         posZ = 0.0f;
+        transform = matrix4{{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}};
+        source_offset = 0;
+        source_length = 0;
         min_point = vector3();
         max_point = vector3();
+        mesh = nullptr;
     }
 
-    void write_to_file(std::string filename) const
+    /**
+     * The object's transform. Headers with no rotation or scale (all-zero
+     * basis) are treated as translation only.
+     */
+    matrix4 placement() const
     {
-        auto stem_path = boost::filesystem::path(filename).stem();
-        auto base_directory = stem_path.parent_path();
+        for (auto i = 0; i < 12; i++)
+        {
+            if (i % 4 != 3 && transform.m[i] != 0)
+            {
+                return transform;
+            }
+        }
+
+        return matrix4{{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, transform.m[12], transform.m[13], transform.m[14], 1}};
+    }
+
+    /**
+     * @param names resolves texture file names; may be null
+     */
+    void write_to_file(std::string filename, const name_dictionary *names = nullptr) const
+    {
+        TRACE_SCOPE_FMT("solid_object::write_to_file", "%s", name.c_str());
+
+        auto stem_path = boost::filesystem::path(filename).replace_extension();
         auto material_library_path = boost::filesystem::path(stem_path).concat(".mtl").string();
         auto object_path = boost::filesystem::path(stem_path).concat(".obj").string();
 
         {
-            simple_filewriter sfw(material_library_path);
+            std::ofstream stream(material_library_path, std::ios::trunc);
+            write_mtl(stream, names);
+        }
 
-            for (auto &material : this->mesh->materials)
-            {
-                sfw.write_line(string_format("newmtl %s", material->name.c_str()));
-                sfw.write_line("Ka 255 255 255");
-                sfw.write_line("Kd 255 255 255");
-                sfw.write_line("Ks 255 255 255");
-
-                auto texture_path = boost::filesystem::path(base_directory).append(string_format("%08X.dds", material->texture_hash)).string();
-                sfw.write_line(string_format("map_Ka %s", texture_path.c_str()));
-                sfw.write_line(string_format("map_Kd %s", texture_path.c_str()));
-                sfw.write_line(string_format("map_Ks %s", texture_path.c_str()));
-            }
+        {
+            std::ofstream stream(object_path, std::ios::trunc);
+            write_obj(stream, boost::filesystem::path(material_library_path).filename().string());
         }
+    }
 
+    void write_mtl(std::ostream &stream, const name_dictionary *names = nullptr) const
+    {
+        for (auto &material : this->mesh->materials)
         {
-            simple_filewriter sfw(object_path);
+            write_line(stream, string_format("newmtl %s", material.name.c_str()));
+            write_line(stream, "Ka 255 255 255");
+            write_line(stream, "Kd 255 255 255");
+            write_line(stream, "Ks 255 255 255");
+
+            auto texture_path = texture_file_name(material.texture_hash, names);
+            write_line(stream, string_format("map_Ka %s", texture_path.c_str()));
+            write_line(stream, string_format("map_Kd %s", texture_path.c_str()));
+            write_line(stream, string_format("map_Ks %s", texture_path.c_str()));
+        }
+    }
 
-            sfw.write_line(string_format("g %s", name.c_str()));
-            sfw.write_line(string_format("mtllib %s", material_library_path.c_str()));
+    void write_obj(std::ostream &stream, const std::string &material_library) const
+    {
+        write_line(stream, string_format("g %s", name.c_str()));
+        write_line(stream, string_format("mtllib %s", material_library.c_str()));
+
+        for (auto &vb : mesh->vertex_buffers)
+        {
+            auto vertices = vb.decode(*vb.data.get());
 
-            for (auto &vb : mesh->vertex_buffers)
+            for (auto i = 0; i < vertices.size(); i++)
             {
-                for (auto i = 0; i < vb->num_verts; i++)
-                {
-                    auto vertex = vb->get_vertex();
-                    sfw.write_line(string_format("# buffer - %d/%d", i + 1, vb->num_verts));
-                    sfw.write_line(string_format("v %f %f %f", vertex.x, vertex.y, vertex.z));
-                    sfw.write_line(string_format("vt %f %f", vertex.u, vertex.v));
-                }
+                auto &vertex = vertices[i];
+                write_line(stream, string_format("# buffer - %d/%d", i + 1, vb.num_verts));
+                write_line(stream, string_format("v %f %f %f", vertex.x, vertex.y, vertex.z));
+                write_line(stream, string_format("vt %f %f", vertex.u, vertex.v));
             }
+        }
 
-            auto faceIdx = 0;
+        auto faces = mesh->faces.get();
+        auto faceIdx = 0;
 
-            for (auto i = 0; i < mesh->num_materials; i++)
-            {
-                auto &material = mesh->materials[i];
+        for (auto i = 0; i < mesh->num_materials; i++)
+        {
+            auto &material = mesh->materials[i];
 
-                sfw.write_line(string_format("usemtl %s", material->name.c_str()));
+            write_line(stream, string_format("usemtl %s", material.name.c_str()));
 
-                for (auto j = 0; j < material->num_tris; j++)
-                {
-                    auto face = mesh->faces[faceIdx + j];
+            for (auto j = 0; j < material.num_tris; j++)
+            {
+                auto face = (*faces)[faceIdx + j];
 
-                    sfw.write_line(string_format("f %d/%d %d/%d %d/%d", face.face1 + 1, face.face1 + 1, face.face2 + 1,
+                write_line(stream, string_format("f %d/%d %d/%d %d/%d", face.face1 + 1, face.face1 + 1, face.face2 + 1,
                                                  face.face2 + 1, face.face3 + 1, face.face3 + 1));
-                }
-
-                faceIdx += material->num_tris;
             }
 
+            faceIdx += material.num_tris;
         }
     }
 };
@@ -159,18 +223,20 @@ class solid_list : public base_data_resource
 public:
     std::string pipeline_path;
     std::string class_type;
-    std::vector<std::shared_ptr<solid_object>> solid_objects;
+    std::unique_ptr<arena> storage; // owns the objects, meshes, records and uncached payloads
+    arena_array<solid_object> solid_objects;
 
-    ~solid_list()
-    {
-        solid_objects.clear();
-    }
+    solid_list() : storage(new arena)
+    {}
 };
 
 class solid_list_stream
 {
 public:
-    solid_list_stream(chunk_stream *chunk_stream, std::shared_ptr<chunk> chunk);
+    /**
+     * @param headers_only if set, only the list info and object headers are read; meshes are skipped
+     */
+    solid_list_stream(chunk_stream *chunk_stream, std::shared_ptr<chunk> chunk, bool headers_only = false);
 
     std::shared_ptr<solid_list> get()
     {
@@ -178,17 +244,33 @@ public:
     }
 
 private:
+    /**
+     * Decoding state of one object; objects are decoded independently.
+     */
+    struct object_state
+    {
+        solid_object *object = nullptr;
+        std::shared_ptr<face_buffer> faces;
+        int named_materials = 0;
+    };
+
     chunk_stream *m_chunk_stream;
     std::shared_ptr<solid_list> m_solid_list;
-    std::shared_ptr<solid_object> m_current_object;
-    int m_named_materials;
-    int m_object_count;
+    bool m_headers_only;
 
     void debug();
 
-    void read_chunks(unsigned int offset, unsigned int length, chunk_stream *stream);
+    /**
+     * Reads the list info, then decodes the objects in parallel.
+     */
+    template<game_id Game>
+    void read_chunks(unsigned int offset, unsigned int length);
+
+    template<game_id Game>
+    void read_object(const chunk &object_chunk, solid_object &object);
 
-    void handle_chunk(std::shared_ptr<chunk> chunk, chunk_stream *stream);
+    template<game_id Game>
+    void handle_chunk(chunk &chunk, chunk_stream *stream, object_state &state);
 };
 
 
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include "texture_index.hpp"
+#include "bundle_watch.hpp"
+#include "chunk_tree.hpp"
+#include "texture_pack_stream.hpp"
+
+const unsigned int kTexturePackChunk = 0xB3300000;
+
+struct PACK texture_index_header
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int file_count;
+    unsigned int entry_count;
+    unsigned int names_size;
+};
+
+const unsigned int kTextureIndexMagic = 0x31495854; // "TXI1"
+const unsigned int kTextureIndexVersion = 1;
+
+static void index_file(const std::string &filename, unsigned int file_index, std::vector<texture_index_entry> &entries)
+{
+    chunk_stream cstream(byte_source::open(filename));
+
+    chunk_tree tree(cstream, 0, (unsigned int) cstream.get_length());
+
+    for (auto &entry : tree)
+    {
+        if (entry.chunk.type != kTexturePackChunk)
+        {
+            continue;
+        }
+
+        auto tpk_chunk = std::make_shared<chunk>(entry.chunk);
+        texture_pack_stream tpk_stream(&cstream, tpk_chunk, true);
+
+        for (auto &texture : tpk_stream.get()->textures)
+        {
+            if (!texture)
+            {
+                continue;
+            }
+
+            texture_index_entry index_entry{};
+            index_entry.texture_hash = texture->texture_hash;
+            index_entry.file_index = file_index;
+            index_entry.chunk_offset = tpk_chunk->offset - sizeof(chunk_header);
+            index_entry.data_offset = texture->source_offset;
+            index_entry.data_size = texture->data_size;
+            index_entry.format = texture->dds_type;
+            index_entry.width = texture->width;
+            index_entry.height = texture->height;
+            index_entry.mipmaps = texture->mipmaps;
+
+            entries.push_back(index_entry);
+        }
+
+        tree.skip_children();
+    }
+}
+
+unsigned int texture_index::build(const std::string &directory, const std::string &index_path)
+{
+    std::vector<std::string> files;
+    std::vector<texture_index_entry> entries;
+
+    for (auto &dir_entry : boost::filesystem::recursive_directory_iterator(directory))
+    {
+        if (!boost::filesystem::is_regular_file(dir_entry.path()))
+        {
+            continue;
+        }
+
+        auto filename = dir_entry.path().string();
+        auto entries_before = entries.size();
+
+        try
+        {
+            index_file(filename, (unsigned int) files.size(), entries);
+        } catch (std::exception &e)
+        {
+            // Not a chunk file, or a damaged one; keep whatever was indexed
+            // before the error. Only bundles are worth a warning, as an
+            // install holds plenty of other files.
+            if (is_bundle_path(filename))
+            {
+                fprintf(stderr, "Skipping the rest of %s: %s\n", filename.c_str(), e.what());
+            }
+        }
+
+        if (entries.size() != entries_before)
+        {
+            files.push_back(filename);
+        }
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [](const texture_index_entry &a, const texture_index_entry &b)
+    {
+        return a.texture_hash < b.texture_hash;
+    });
+
+    std::string names;
+
+    for (auto &file : files)
+    {
+        names.append(file.c_str(), file.size() + 1);
+    }
+
+    names.resize((names.size() + 3) & ~3u, '\0');
+
+    texture_index_header header{};
+    header.magic = kTextureIndexMagic;
+    header.version = kTextureIndexVersion;
+    header.file_count = (unsigned int) files.size();
+    header.entry_count = (unsigned int) entries.size();
+    header.names_size = (unsigned int) names.size();
+
+    std::ofstream stream(index_path, std::ios::trunc | std::ios::binary);
+    stream.write((const char *) &header, sizeof(header));
+    stream.write(names.data(), names.size());
+    stream.write((const char *) entries.data(), entries.size() * sizeof(texture_index_entry));
+
+    if (!stream)
+    {
+        throw std::runtime_error(string_format("Failed to write texture index %s", index_path.c_str()));
+    }
+
+    return header.entry_count;
+}
+
+texture_index::texture_index(const std::string &index_path)
+{
+    std::ifstream stream(index_path, std::ios::binary);
+    texture_index_header header{};
+
+    if (!stream.read((char *) &header, sizeof(header))
+        || header.magic != kTextureIndexMagic || header.version != kTextureIndexVersion)
+    {
+        throw std::runtime_error(string_format("Not a texture index: %s", index_path.c_str()));
+    }
+
+    std::vector<char> names(header.names_size);
+    m_entries.resize(header.entry_count);
+
+    stream.read(names.data(), names.size());
+    stream.read((char *) m_entries.data(), m_entries.size() * sizeof(texture_index_entry));
+
+    if (!stream)
+    {
+        throw std::runtime_error(string_format("Truncated texture index: %s", index_path.c_str()));
+    }
+
+    for (size_t pos = 0; m_files.size() < header.file_count && pos < names.size();)
+    {
+        m_files.emplace_back(&names[pos]);
+        pos += m_files.back().size() + 1;
+    }
+
+    for (auto &entry : m_entries)
+    {
+        if (entry.file_index >= m_files.size())
+        {
+            throw std::runtime_error(string_format("Corrupt texture index: %s", index_path.c_str()));
+        }
+    }
+}
+
+const texture_index_entry *texture_index::find(unsigned int texture_hash) const
+{
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), texture_hash,
+                               [](const texture_index_entry &entry, unsigned int hash)
+                               {
+                                   return entry.texture_hash < hash;
+                               });
+
+    if (it == m_entries.end() || it->texture_hash != texture_hash)
+    {
+        return nullptr;
+    }
+
+    return &*it;
+}
+
+std::vector<unsigned char> texture_index::read_payload(const texture_index_entry &entry) const
+{
+    std::ifstream stream(file_name(entry), std::ios::binary);
+    std::vector<unsigned char> payload(entry.data_size);
+
+    stream.seekg(entry.data_offset);
+    stream.read((char *) payload.data(), payload.size());
+
+    if (!stream)
+    {
+        throw std::runtime_error(string_format("Failed to read texture %08X from %s", entry.texture_hash,
+                                               file_name(entry).c_str()));
+    }
+
+    return payload;
+}
+
+void texture_index::extract(const texture_index_entry &entry, const std::string &filename) const
+{
+    auto payload = std::make_shared<std::vector<unsigned char>>(read_payload(entry));
+
+    texture tex;
+    tex.texture_hash = entry.texture_hash;
+    tex.width = entry.width;
+    tex.height = entry.height;
+    tex.mipmaps = entry.mipmaps;
+    tex.dds_type = entry.format;
+    tex.data_offset = 0;
+    tex.data_size = entry.data_size;
+    tex.source_offset = entry.data_offset;
+    tex.data = cached<std::vector<unsigned char>>(nullptr, cache_key{}, payload, nullptr);
+
+    tex.write_to_file(filename);
+}
@@ -0,0 +1,69 @@
+#ifndef EXPLORER_TEXTURE_INDEX_HPP
+#define EXPLORER_TEXTURE_INDEX_HPP
+
+#include <string>
+#include <vector>
+#include "utils.hpp"
+
+struct PACK texture_index_entry
+{
+    unsigned int texture_hash;
+    unsigned int file_index;
+    unsigned int chunk_offset; // 0xB3300000 chunk the texture was found in
+    unsigned int data_offset;  // absolute file offset of the payload
+    unsigned int data_size;
+    unsigned int format;       // DDS FourCC, or 0x15 for A8R8G8B8
+    unsigned int width, height, mipmaps;
+};
+
+/**
+ * Sorted, on-disk map of texture hash -> payload location for every texture
+ * pack found under a directory.
+ *
+ * Layout: texture_index_header, the NUL-terminated file names, padding to 4
+ * bytes, then entry_count texture_index_entry records sorted by hash.
+ */
+class texture_index
+{
+public:
+    /**
+     * Scans every regular file under directory and writes the index to index_path.
+     *
+     * @return number of textures indexed
+     */
+    static unsigned int build(const std::string &directory, const std::string &index_path);
+
+    explicit texture_index(const std::string &index_path);
+
+    /**
+     * @return the first entry with this hash, or nullptr
+     */
+    const texture_index_entry *find(unsigned int texture_hash) const;
+
+    const std::string &file_name(const texture_index_entry &entry) const
+    {
+        return m_files[entry.file_index];
+    }
+
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    /**
+     * Reads the texture payload with a single seek.
+     */
+    std::vector<unsigned char> read_payload(const texture_index_entry &entry) const;
+
+    /**
+     * Writes the texture as a DDS file.
+     */
+    void extract(const texture_index_entry &entry, const std::string &filename) const;
+
+private:
+    std::vector<std::string> m_files;
+    std::vector<texture_index_entry> m_entries;
+};
+
+
+#endif //EXPLORER_TEXTURE_INDEX_HPP
@@ -1,64 +1,42 @@
 #include "texture_pack_stream.hpp"
+#include "chunk_tree.hpp"
+#include "trace.hpp"
 
-struct PACK texture_pack_info_struct
-{
-    unsigned int version;
-    char name[28];
-    char pipeline_path[64];
-    unsigned int hash;
-};
-
-struct PACK texture_info_struct
-{
-    unsigned char blank[12];
-    unsigned int tex_hash, type_hash;
-    unsigned int unknown1;
-    unsigned int data_size;
-    unsigned int unknown2;
-    unsigned int width, height, mip_count;
-    unsigned int unknown3, unknown4;
-    unsigned char unknown5[24];
-    unsigned int unknown6;
-    unsigned int data_offset;
-    unsigned char unknown7[60];
-    unsigned char name_length;
-};
-
-texture_pack_stream::texture_pack_stream(chunk_stream *chunk_stream, std::shared_ptr<chunk> chunk)
+texture_pack_stream::texture_pack_stream(chunk_stream *chunk_stream, std::shared_ptr<chunk> chunk, bool headers_only)
 {
     m_texture_count = 0;
+    m_headers_only = headers_only;
     this->m_texture_pack.reset(new texture_pack);
     this->m_chunk_stream = chunk_stream;
-    this->read_chunks(chunk->offset, chunk->length, chunk_stream);
+
+    this->read_chunks<GAME_WORLD>(chunk->offset, chunk->length);
 }
 
-void texture_pack_stream::read_chunks(unsigned int offset, unsigned int length, chunk_stream *stream)
+template<game_id Game>
+void texture_pack_stream::read_chunks(unsigned int offset, unsigned int length)
 {
-    auto tmpStream = m_chunk_stream->substream(offset, length);
-
-    while (tmpStream->data_remaining())
+    for (auto &entry : chunk_tree(*m_chunk_stream, offset, length))
     {
-        auto tmpChunk = tmpStream->read_chunk();
-
-        if (tmpChunk->is_parent)
+        if (!entry.chunk.is_parent)
         {
-            read_chunks(tmpChunk->offset, tmpChunk->length, &*tmpStream);
-        } else
-        {
-            this->handle_chunk(tmpChunk, &*tmpStream);
+            auto chunk = entry.chunk;
+            this->handle_chunk<Game>(chunk, m_chunk_stream);
         }
-
-        tmpStream->skip_chunk(tmpChunk);
     }
 }
 
-void texture_pack_stream::handle_chunk(std::shared_ptr<chunk> chunk, chunk_stream *stream)
+template<game_id Game>
+void texture_pack_stream::handle_chunk(chunk &chunk, chunk_stream *stream)
 {
-    switch (chunk->type)
+    using traits = game_traits<Game>;
+
+    TRACE_SCOPE_FMT("texture_pack_stream::handle_chunk", "%08X @ %08X", chunk.type, chunk.offset);
+
+    switch (chunk.type)
     {
         case 0x33310001:
         {
-            auto tpk_info = stream->read<texture_pack_info_struct>();
+            auto tpk_info = stream->read<typename traits::texture_pack_info_struct>();
 
             m_texture_pack->pipeline_path = std::string(tpk_info.pipeline_path);
             m_texture_pack->name = std::string(tpk_info.name);
@@ -68,14 +46,14 @@ void texture_pack_stream::handle_chunk(std::shared_ptr<chunk> chunk, chunk_strea
         }
         case 0x33310002:
         {
-            m_texture_pack->textures.resize(chunk->length >> 3);
+            m_texture_pack->textures.resize(chunk.length >> 3);
             break;
         }
         case 0x33310004:
         {
             for (auto i = 0; i < m_texture_pack->textures.size(); i++)
             {
-                auto texture_info = stream->read<texture_info_struct>();
+                auto texture_info = stream->read<typename traits::texture_info_struct>();
 
                 char *name_tmp = (char *) malloc(texture_info.name_length);
                 stream->read(name_tmp, texture_info.name_length);
@@ -101,10 +79,8 @@ void texture_pack_stream::handle_chunk(std::shared_ptr<chunk> chunk, chunk_strea
         {
             for (auto i = 0; i < m_texture_pack->textures.size(); i++)
             {
-                stream->seek(12, SEEK_CUR);
-                stream->read(&m_texture_pack->textures[i]->dds_type, 4);
-                stream->seek(16, SEEK_CUR);
-//                m_texture_pack->textures[i]->dds_type = stream->read
+                auto format = stream->read<typename traits::texture_format_struct>();
+                m_texture_pack->textures[i]->dds_type = format.dds_type;
             }
 
             break;
@@ -113,12 +89,34 @@ void texture_pack_stream::handle_chunk(std::shared_ptr<chunk> chunk, chunk_strea
         {
             stream->align_padding(chunk);
 
-            unsigned char* data_buffer = (unsigned char*) malloc(chunk->length);
-            stream->read(data_buffer, chunk->length);
+            auto &textures = m_texture_pack->textures;
 
-            for (auto i = 0; i < m_texture_pack->textures.size(); i++)
+            for (auto &texture : textures)
+            {
+                if (texture->data_offset + (unsigned long long) texture->data_size > chunk.length)
+                {
+                    throw std::runtime_error(string_format("Texture %08X lies outside its data chunk.",
+                                                           texture->texture_hash));
+                }
+
+                texture->source_offset = chunk.offset + texture->data_offset;
+            }
+
+            auto source = stream->source();
+            auto cache = stream->cache();
+
+            for (auto &texture : textures)
             {
-                m_texture_pack->textures[i]->data_buffer = data_buffer;
+                auto source_offset = texture->source_offset;
+                auto data_size = texture->data_size;
+                auto payload = m_headers_only ? nullptr : source->read_vector_at<unsigned char>(source_offset, data_size);
+
+                texture->data = cached<std::vector<unsigned char>>(
+                        cache, cache_key{source->id(), 0x33320002, source_offset}, payload,
+                        [source, source_offset, data_size]()
+                        {
+                            return source->read_vector_at<unsigned char>(source_offset, data_size);
+                        });
             }
 
             break;
@@ -5,7 +5,9 @@
 #include <memory>
 #include <vector>
 #include "chunk_stream.hpp"
+#include "game_traits.hpp"
 #include "DDS.h"
+#include "trace.hpp"
 
 class texture
 {
@@ -16,13 +18,11 @@ public:
     unsigned int texture_hash;
     unsigned int type_hash;
     unsigned int data_offset, data_size;
-    unsigned char *data_buffer;
+    unsigned int source_offset; // absolute file offset of the payload
+    cached<std::vector<unsigned char>> data;
 
-    void write_to_file(std::string filename) const
+    DirectX::DDS_HEADER dds_header() const
     {
-        std::ofstream stream(filename, std::ios::trunc | std::ios::binary);
-
-        stream.write((const char*) &DirectX::DDS_MAGIC, 4);
         DirectX::DDS_HEADER dds_header{};
 
         dds_header.dwSize = 0x7C;
@@ -47,8 +47,38 @@ public:
             dds_header.dwCaps = 0x401008;
         }
 
-        stream.write((const char*) &dds_header, sizeof(DirectX::DDS_HEADER));
-        stream.write((const char*) (data_buffer + data_offset), data_size);
+        return dds_header;
+    }
+
+    void write_to_file(std::string filename) const
+    {
+        write_to_file(filename, *data.get());
+    }
+
+    /**
+     * Writes the texture with a payload the caller has already loaded, so
+     * that an uncached payload isn't read from the bundle again.
+     */
+    void write_to_file(std::string filename, const std::vector<unsigned char> &payload) const
+    {
+        TRACE_SCOPE_FMT("texture::write_to_file", "%08X", texture_hash);
+
+        std::ofstream stream(filename, std::ios::trunc | std::ios::binary);
+        write_dds(stream, payload);
+    }
+
+    void write_dds(std::ostream &stream) const
+    {
+        write_dds(stream, *data.get());
+    }
+
+    void write_dds(std::ostream &stream, const std::vector<unsigned char> &payload) const
+    {
+        auto header = dds_header();
+
+        stream.write((const char*) &DirectX::DDS_MAGIC, 4);
+        stream.write((const char*) &header, sizeof(DirectX::DDS_HEADER));
+        stream.write((const char*) payload.data(), payload.size());
     }
 };
 
@@ -69,7 +99,10 @@ public:
 class texture_pack_stream
 {
 public:
-    texture_pack_stream(chunk_stream *chunk_stream, std::shared_ptr<chunk> chunk);
+    /**
+     * @param headers_only if set, texture payloads are located but only read when first used
+     */
+    texture_pack_stream(chunk_stream *chunk_stream, std::shared_ptr<chunk> chunk, bool headers_only = false);
 
     std::shared_ptr<texture_pack> get()
     {
@@ -80,12 +113,15 @@ private:
     chunk_stream *m_chunk_stream;
     std::shared_ptr<texture_pack> m_texture_pack;
     int m_texture_count;
+    bool m_headers_only;
 
     void debug();
 
-    void read_chunks(unsigned int offset, unsigned int length, chunk_stream *stream);
+    template<game_id Game>
+    void read_chunks(unsigned int offset, unsigned int length);
 
-    void handle_chunk(std::shared_ptr<chunk> chunk, chunk_stream *stream);
+    template<game_id Game>
+    void handle_chunk(chunk &chunk, chunk_stream *stream);
 };
 
 
@@ -0,0 +1,96 @@
+#include "thread_pool.hpp"
+
+static thread_local bool t_in_parallel_for = false;
+
+bool in_parallel_for()
+{
+    return t_in_parallel_for;
+}
+
+thread_pool &thread_pool::instance()
+{
+    static thread_pool pool;
+    return pool;
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_work.notify_all();
+
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void thread_pool::run(size_t helpers, const std::function<void()> &task)
+{
+    batch job{&task, helpers};
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        while (m_workers.size() < helpers)
+        {
+            m_workers.emplace_back(&thread_pool::work, this);
+        }
+
+        m_queue.insert(m_queue.end(), helpers, &job);
+    }
+
+    m_work.notify_all();
+
+    t_in_parallel_for = true;
+    task();
+    t_in_parallel_for = false;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Copies still queued would find every index taken; drop them rather
+    // than wait for a worker busy with another loop.
+    auto queued = std::count(m_queue.begin(), m_queue.end(), &job);
+    m_queue.erase(std::remove(m_queue.begin(), m_queue.end(), &job), m_queue.end());
+    job.pending -= queued;
+
+    m_done.wait(lock, [&job]()
+    {
+        return job.pending == 0;
+    });
+}
+
+void thread_pool::work()
+{
+    t_in_parallel_for = true;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_work.wait(lock, [this]()
+        {
+            return m_stopping || !m_queue.empty();
+        });
+
+        if (m_queue.empty())
+        {
+            return;
+        }
+
+        auto job = m_queue.front();
+        m_queue.pop_front();
+
+        lock.unlock();
+        (*job->task)();
+        lock.lock();
+
+        if (--job->pending == 0)
+        {
+            m_done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef EXPLORER_THREAD_POOL_HPP
+#define EXPLORER_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Number of threads parallel_for() uses. Defaults to the hardware
+ * concurrency; set_worker_count(1) makes every loop run serially.
+ */
+inline std::atomic<unsigned int> &worker_count_setting()
+{
+    static std::atomic<unsigned int> count(std::max(1u, std::thread::hardware_concurrency()));
+    return count;
+}
+
+inline unsigned int worker_count()
+{
+    return worker_count_setting();
+}
+
+inline void set_worker_count(unsigned int count)
+{
+    worker_count_setting() = std::max(1u, count);
+}
+
+/**
+ * Threads that help run parallel_for() loops. They are started on first use,
+ * as many as the largest loop has asked for, and kept until exit.
+ */
+class thread_pool
+{
+public:
+    static thread_pool &instance();
+
+    ~thread_pool();
+
+    /**
+     * Runs task on the calling thread and on up to helpers pool threads, and
+     * returns once every started copy has finished. Copies that haven't
+     * started when the calling thread's copy returns are dropped, so task
+     * must leave no work behind for them. task must not throw.
+     */
+    void run(size_t helpers, const std::function<void()> &task);
+
+    thread_pool(const thread_pool &) = delete;
+
+    thread_pool &operator=(const thread_pool &) = delete;
+
+private:
+    struct batch
+    {
+        const std::function<void()> *task;
+        size_t pending;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_work;
+    std::condition_variable m_done;
+    std::deque<batch *> m_queue;
+    std::vector<std::thread> m_workers;
+    bool m_stopping = false;
+
+    thread_pool() = default;
+
+    void work();
+};
+
+/**
+ * @return whether the calling thread is running a parallel_for() body
+ */
+bool in_parallel_for();
+
+/**
+ * Calls body(i) for every i in [0, count), spread over up to worker_count()
+ * threads of the shared pool. The calling thread takes part, and indices are
+ * handed out one at a time so uneven items balance out. Loops nested in a
+ * body run serially on its thread. If body throws, the remaining indices are
+ * skipped and the first exception is rethrown once every thread is done.
+ */
+template<typename Body>
+void parallel_for(size_t count, Body body)
+{
+    auto threads = (size_t) std::min<size_t>(worker_count(), count);
+
+    if (threads <= 1 || in_parallel_for())
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            body(i);
+        }
+
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    std::function<void()> work = [&]()
+    {
+        for (auto i = next++; i < count; i = next++)
+        {
+            try
+            {
+                body(i);
+            } catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+
+                next = count;
+            }
+        }
+    };
+
+    thread_pool::instance().run(threads - 1, work);
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+
+#endif //EXPLORER_THREAD_POOL_HPP
@@ -0,0 +1,185 @@
+#include "trace.hpp"
+#include "utils.hpp"
+
+#ifdef EXPLORER_TRACING
+
+#include <cstdarg>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> g_trace_enabled(false);
+
+struct trace_event
+{
+    const char *name;
+    char detail[48];
+    long long begin_ns, duration_ns;
+};
+
+/**
+ * Per-thread ring of at most kCapacity events; once full, the oldest events
+ * are overwritten. It grows as events arrive, so short-lived threads don't
+ * pay for a full ring.
+ */
+struct trace_buffer
+{
+    static constexpr size_t kCapacity = 1 << 16;
+
+    unsigned int thread_id;
+    size_t count;
+    std::vector<trace_event> events;
+
+    explicit trace_buffer(unsigned int thread_id) : thread_id(thread_id), count(0)
+    {}
+
+    trace_event &next()
+    {
+        if (events.size() < kCapacity)
+        {
+            events.emplace_back();
+            return events[count++];
+        }
+
+        return events[count++ % kCapacity];
+    }
+};
+
+static std::mutex g_trace_mutex;
+static std::vector<std::unique_ptr<trace_buffer>> g_trace_buffers;
+static std::vector<trace_buffer *> g_free_trace_buffers;
+static std::chrono::steady_clock::time_point g_trace_epoch;
+static std::string g_trace_path;
+
+/**
+ * A thread's claim on a buffer. Buffers are owned by the registry so their
+ * events outlive the thread; when the thread exits, its buffer goes back on
+ * the free list and the next new thread continues it under the same id.
+ * The number of buffers is thus bounded by the most threads alive at once.
+ */
+struct trace_buffer_lease
+{
+    trace_buffer *buffer = nullptr;
+
+    ~trace_buffer_lease()
+    {
+        if (buffer != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(g_trace_mutex);
+            g_free_trace_buffers.push_back(buffer);
+        }
+    }
+};
+
+static trace_buffer *thread_trace_buffer()
+{
+    thread_local trace_buffer_lease lease;
+
+    if (lease.buffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(g_trace_mutex);
+
+        if (!g_free_trace_buffers.empty())
+        {
+            lease.buffer = g_free_trace_buffers.back();
+            g_free_trace_buffers.pop_back();
+        } else
+        {
+            g_trace_buffers.emplace_back(new trace_buffer((unsigned int) g_trace_buffers.size() + 1));
+            lease.buffer = g_trace_buffers.back().get();
+        }
+    }
+
+    return lease.buffer;
+}
+
+trace_span::trace_span(const char *name, const char *fmt, ...) : trace_span(name)
+{
+    if (m_name != nullptr)
+    {
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(m_detail, sizeof(m_detail), fmt, ap);
+        va_end(ap);
+    }
+}
+
+trace_span::~trace_span()
+{
+    if (m_name == nullptr)
+    {
+        return;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto buffer = thread_trace_buffer();
+    auto &event = buffer->next();
+
+    event.name = m_name;
+    memcpy(event.detail, m_detail, sizeof(event.detail));
+    event.begin_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(m_begin - g_trace_epoch).count();
+    event.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_begin).count();
+}
+
+void trace_begin_session(const std::string &path)
+{
+    g_trace_path = path;
+    g_trace_epoch = std::chrono::steady_clock::now();
+    g_trace_enabled = true;
+}
+
+void trace_end_session()
+{
+    if (!g_trace_enabled.exchange(false))
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(g_trace_mutex);
+    std::ofstream stream(g_trace_path, std::ios::trunc);
+    auto first = true;
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for (auto &buffer : g_trace_buffers)
+    {
+        auto count = std::min(buffer->count, trace_buffer::kCapacity);
+
+        for (auto i = buffer->count - count; i < buffer->count; i++)
+        {
+            auto &event = buffer->events[i % trace_buffer::kCapacity];
+
+            stream << (first ? "\n" : ",\n");
+            stream << string_format(R"({"name":"%s","cat":"explorer","ph":"X","pid":1,"tid":%u,"ts":%.3f,"dur":%.3f)",
+                                    event.name, buffer->thread_id, event.begin_ns / 1000.0,
+                                    event.duration_ns / 1000.0);
+
+            if (event.detail[0] != '\0')
+            {
+                stream << ",\"args\":{\"detail\":\"" << json_escape(event.detail) << "\"}";
+            }
+
+            stream << "}";
+            first = false;
+        }
+
+        buffer->count = 0;
+        buffer->events.clear();
+        buffer->events.shrink_to_fit();
+    }
+
+    stream << "\n]}\n";
+}
+
+#else
+
+void trace_begin_session(const std::string &path)
+{
+    fprintf(stderr, "Tracing is compiled out; reconfigure with -DEXPLORER_TRACING=ON to write %s.\n", path.c_str());
+}
+
+void trace_end_session()
+{
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef EXPLORER_TRACE_HPP
+#define EXPLORER_TRACE_HPP
+
+#include <string>
+
+/**
+ * Starts recording trace spans; they are written to path as Chrome
+ * trace-event JSON (loadable in Perfetto or chrome://tracing) by
+ * trace_end_session(). Without EXPLORER_TRACING this only prints a warning.
+ */
+void trace_begin_session(const std::string &path);
+
+void trace_end_session();
+
+#ifdef EXPLORER_TRACING
+
+#include <atomic>
+#include <chrono>
+
+extern std::atomic<bool> g_trace_enabled;
+
+/**
+ * Records one complete ("X") event covering its own lifetime into the
+ * calling thread's ring buffer.
+ */
+class trace_span
+{
+public:
+    explicit trace_span(const char *name) : m_name(name), m_detail{}
+    {
+        if (g_trace_enabled.load(std::memory_order_relaxed))
+        {
+            m_begin = std::chrono::steady_clock::now();
+        } else
+        {
+            m_name = nullptr;
+        }
+    }
+
+    trace_span(const char *name, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+    ~trace_span();
+
+    trace_span(const trace_span &) = delete;
+
+    trace_span &operator=(const trace_span &) = delete;
+
+private:
+    const char *m_name;
+    char m_detail[48];
+    std::chrono::steady_clock::time_point m_begin;
+};
+
+#define EXPLORER_TRACE_CONCAT_(a, b) a##b
+#define EXPLORER_TRACE_CONCAT(a, b) EXPLORER_TRACE_CONCAT_(a, b)
+
+#define TRACE_SCOPE(name) trace_span EXPLORER_TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define TRACE_SCOPE_FMT(name, ...) trace_span EXPLORER_TRACE_CONCAT(trace_span_, __LINE__)(name, __VA_ARGS__)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_SCOPE_FMT(name, ...) do {} while (0)
+
+#endif
+
+
+#endif //EXPLORER_TRACE_HPP
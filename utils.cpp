@@ -21,4 +21,125 @@ std::string string_format(const std::string fmt_str, ...)
             break;
     }
     return std::string(formatted.get());
-}
\ No newline at end of file
+}
+std::string json_escape(const std::string &text)
+{
+    std::string result;
+
+    for (auto c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        } else if ((unsigned char) c < 0x20)
+        {
+            result += string_format("\\u%04x", c);
+        } else
+        {
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+static const unsigned long long kPrime64_1 = 0x9E3779B185EBCA87ULL;
+static const unsigned long long kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const unsigned long long kPrime64_3 = 0x165667B19E3779F9ULL;
+static const unsigned long long kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const unsigned long long kPrime64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline unsigned long long rotl64(unsigned long long x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline unsigned long long read64(const unsigned char *p)
+{
+    unsigned long long v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline unsigned int read32(const unsigned char *p)
+{
+    unsigned int v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline unsigned long long xxh64_round(unsigned long long acc, unsigned long long input)
+{
+    acc += input * kPrime64_2;
+    acc = rotl64(acc, 31);
+    return acc * kPrime64_1;
+}
+
+static inline unsigned long long xxh64_merge(unsigned long long acc, unsigned long long val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * kPrime64_1 + kPrime64_4;
+}
+
+// XXH64, see https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+unsigned long long hash_bytes(const void *data, size_t size, unsigned long long seed)
+{
+    auto p = (const unsigned char *) data;
+    auto end = p + size;
+    unsigned long long h;
+
+    if (size >= 32)
+    {
+        unsigned long long v1 = seed + kPrime64_1 + kPrime64_2;
+        unsigned long long v2 = seed + kPrime64_2;
+        unsigned long long v3 = seed;
+        unsigned long long v4 = seed - kPrime64_1;
+
+        for (; p + 32 <= end; p += 32)
+        {
+            v1 = xxh64_round(v1, read64(p));
+            v2 = xxh64_round(v2, read64(p + 8));
+            v3 = xxh64_round(v3, read64(p + 16));
+            v4 = xxh64_round(v4, read64(p + 24));
+        }
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64_merge(h, v1);
+        h = xxh64_merge(h, v2);
+        h = xxh64_merge(h, v3);
+        h = xxh64_merge(h, v4);
+    } else
+    {
+        h = seed + kPrime64_5;
+    }
+
+    h += size;
+
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= xxh64_round(0, read64(p));
+        h = rotl64(h, 27) * kPrime64_1 + kPrime64_4;
+    }
+
+    if (p + 4 <= end)
+    {
+        h ^= read32(p) * kPrime64_1;
+        h = rotl64(h, 23) * kPrime64_2 + kPrime64_3;
+        p += 4;
+    }
+
+    for (; p < end; p++)
+    {
+        h ^= (*p) * kPrime64_5;
+        h = rotl64(h, 11) * kPrime64_1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime64_2;
+    h ^= h >> 29;
+    h *= kPrime64_3;
+    h ^= h >> 32;
+
+    return h;
+}
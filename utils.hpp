@@ -4,14 +4,25 @@
 #include <iostream>
 #include <sstream>
 #include <string>
-#include <streambuf>
+#include <cstring>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 
 #define PACK __attribute__((__packed__))
 
 std::string string_format(const std::string fmt_str, ...);
 
+/**
+ * Escapes text for use inside a JSON string literal.
+ */
+std::string json_escape(const std::string &text);
+
+/**
+ * 64-bit non-cryptographic content hash (XXH64) used to fingerprint chunk payloads.
+ */
+unsigned long long hash_bytes(const void *data, size_t size, unsigned long long seed = 0);
+
 struct PACK vector3
 {
     float x, y, z;
@@ -32,7 +43,7 @@ struct PACK vector4
     }
 };
 
-struct PACK matrix4
+struct matrix4
 {
     float m[16];
 
@@ -42,78 +53,11 @@ struct PACK matrix4
     }
 };
 
-struct substreambuf : public std::streambuf
+inline void write_line(std::ostream &stream, const std::string &line)
 {
-    explicit substreambuf(std::streambuf *sbuf, std::streampos pos, std::streampos len) :
-            m_sbuf(sbuf),
-            m_pos(pos),
-            m_len(len),
-            m_read(0)
-    {
-        m_sbuf->pubseekpos(pos);
-
-        setbuf(nullptr, 0);
-    }
-
-protected:
-    int underflow()
-    {
-        if (m_read >= m_len)
-        {
-            return std::istream::traits_type::eof();
-        }
-
-        return m_sbuf->sgetc();
-    }
-
-    int uflow()
-    {
-        if (m_read >= m_len)
-        {
-            return std::istream::traits_type::eof();
-        }
-
-        m_read += 1;
-
-        return m_sbuf->sbumpc();
-    }
-
-    std::streampos seekoff(std::streamoff off, std::ios_base::seekdir seekdir,
-                           std::ios_base::openmode openmode = std::ios_base::in | std::ios_base::out)
-    {
-        if (seekdir == std::ios_base::beg)
-        {
-            off += ((long) m_pos);
-        } else if (seekdir == std::ios_base::cur)
-        {
-            off += ((long) m_pos) + ((long) m_read);
-        } else if (seekdir == std::ios_base::end)
-        {
-            off += ((long) m_pos) + ((long) m_len);
-        }
-
-        return m_sbuf->pubseekpos(off, openmode) - m_pos;
-    }
-
-    std::streampos
-    seekpos(std::streampos streampos, std::ios_base::openmode openmode = std::ios_base::in | std::ios_base::out)
-    {
-        streampos += m_pos;
-
-        if (streampos > ((long) m_pos) + ((long) m_len))
-        {
-            return -1;
-        }
-
-        return m_sbuf->pubseekpos(streampos, openmode) - m_pos;
-    }
-
-private:
-    std::streambuf *m_sbuf;
-    std::streampos m_pos;
-    std::streamsize m_len;
-    std::streampos m_read;
-};
+    stream.write(line.c_str(), line.length());
+    stream.put('\n');
+}
 
 class simple_filewriter
 {
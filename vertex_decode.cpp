@@ -0,0 +1,83 @@
+#include "vertex_decode.hpp"
+
+/**
+ * Decodes vertices of a stride known at compile time, so the field offsets
+ * and the loop step are constants and the loop can be unrolled.
+ */
+template<unsigned int Stride>
+static void decode_vertices_fixed(const float *data, size_t count, solid_mesh_vertex *out)
+{
+    static_assert(Stride >= 7, "fixed-stride vertices hold texture coordinates");
+
+    for (size_t i = 0; i < count; i++, data += Stride)
+    {
+        auto &vertex = out[i];
+
+        vertex.x = data[0];
+        vertex.y = data[2];
+        vertex.z = data[1];
+        memcpy(&vertex.color, &data[3], sizeof(vertex.color));
+        vertex.u = data[5];
+        vertex.v = -data[6];
+    }
+}
+
+/**
+ * Decodes vertices of any stride, including ones too short for a color or
+ * texture coordinates.
+ */
+static void decode_vertices_generic(const float *data, size_t count, unsigned int stride, solid_mesh_vertex *out)
+{
+    for (size_t i = 0; i < count; i++, data += stride)
+    {
+        auto &vertex = out[i];
+
+        vertex.x = data[0];
+        vertex.y = stride >= 3 ? data[2] : 0;
+        vertex.z = stride >= 2 ? data[1] : 0;
+        vertex.color = 0;
+        vertex.u = vertex.v = 0;
+
+        if (stride >= 4)
+        {
+            memcpy(&vertex.color, &data[3], sizeof(vertex.color));
+        }
+
+        if (stride >= 7)
+        {
+            vertex.u = data[5];
+            vertex.v = -data[6];
+        }
+    }
+}
+
+void decode_vertices(const float *data, size_t count, unsigned int stride, solid_mesh_vertex *out)
+{
+    // Strides from the smallest vertex with texture coordinates up to 64
+    // bytes get a fixed-stride kernel; the switch runs once per buffer.
+    switch (stride)
+    {
+        case 7:
+            return decode_vertices_fixed<7>(data, count, out);
+        case 8:
+            return decode_vertices_fixed<8>(data, count, out);
+        case 9:
+            return decode_vertices_fixed<9>(data, count, out);
+        case 10:
+            return decode_vertices_fixed<10>(data, count, out);
+        case 11:
+            return decode_vertices_fixed<11>(data, count, out);
+        case 12:
+            return decode_vertices_fixed<12>(data, count, out);
+        case 13:
+            return decode_vertices_fixed<13>(data, count, out);
+        case 14:
+            return decode_vertices_fixed<14>(data, count, out);
+        case 15:
+            return decode_vertices_fixed<15>(data, count, out);
+        case 16:
+            return decode_vertices_fixed<16>(data, count, out);
+        default:
+            return decode_vertices_generic(data, count, stride, out);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef EXPLORER_VERTEX_DECODE_HPP
+#define EXPLORER_VERTEX_DECODE_HPP
+
+#include <cstddef>
+#include <cstring>
+
+struct solid_mesh_vertex
+{
+public:
+    float x;
+    float y;
+    float z;
+    unsigned int color;
+    float u;
+    float v;
+};
+
+/**
+ * Decodes count World vertices of stride floats each. Every layout starts
+ * with the position, followed by the packed color and, from 7 floats up, the
+ * texture coordinates. Strides of 7 to 16 floats are decoded by kernels
+ * compiled for that stride; others by a generic loop. Whatever follows the
+ * texture coordinates (normals, tangents, extra UV sets) is not decoded, as
+ * its layout is not known. Swaps Y and Z and flips V, as exported files expect.
+ */
+void decode_vertices(const float *data, size_t count, unsigned int stride, solid_mesh_vertex *out);
+
+
+#endif //EXPLORER_VERTEX_DECODE_HPP